@@ -0,0 +1,91 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * A bump allocator owned by one compilation. Objects are carved out of large
+ * blocks in allocation order, so a tree built from it is laid out roughly in
+ * the order it is walked, and everything is released at once when the arena
+ * is destroyed. No destructors are run, so only trivially destructible types
+ * may be allocated from it.
+ */
+class Arena {
+    static constexpr size_t BLOCK_SIZE = 1 << 16;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char *next = nullptr;
+    char *end = nullptr;
+
+    void *allocate(size_t size, size_t align) {
+      size_t pad = (align - reinterpret_cast<uintptr_t>(next) % align) % align;
+      if (next == nullptr || size_t(end - next) < pad + size) {
+        // start a new block; oversized requests get a block of their own
+        size_t blockSize = std::max(BLOCK_SIZE, size + align);
+        blocks.emplace_back(new char[blockSize]);
+        next = blocks.back().get();
+        end = next + blockSize;
+        pad = (align - reinterpret_cast<uintptr_t>(next) % align) % align;
+      }
+      void *p = next + pad;
+      next += pad + size;
+      return p;
+    }
+
+  public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    template <typename T, typename... Args>
+    T *make(Args &&...args) {
+      static_assert(std::is_trivially_destructible<T>::value,
+                    "objects in an Arena are never destroyed");
+      return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Allocates n value-initialized objects
+    template <typename T>
+    T *makeArray(size_t n) {
+      static_assert(std::is_trivially_destructible<T>::value,
+                    "objects in an Arena are never destroyed");
+      if (n == 0) return nullptr;
+      return new (allocate(sizeof(T) * n, alignof(T))) T[n]();
+    }
+
+    // Frees everything allocated so far; the arena can then be reused
+    void clear() {
+      blocks.clear();
+      next = end = nullptr;
+    }
+
+    // Copies s into the arena; the view stays valid until the arena is
+    // cleared or destroyed
+    std::string_view copy(std::string_view s) {
+      if (s.empty()) return {};
+      char *p = static_cast<char *>(allocate(s.size(), 1));
+      std::memcpy(p, s.data(), s.size());
+      return {p, s.size()};
+    }
+};
+
+// A fixed-size array allocated from an Arena, such as a node's children
+template <typename T>
+struct Span {
+  T *items = nullptr;
+  size_t count = 0;
+
+  T *begin() const { return items; }
+  T *end() const { return items + count; }
+  size_t size() const { return count; }
+  T &operator[](size_t i) const { return items[i]; }
+};
+
+#endif
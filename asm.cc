@@ -1,12 +1,12 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <map>
+#include <unordered_map>
 #include "scanner.h"
 
 struct Instruction {
   std::string name;
-  std::string labelName = "";
+  int labelId = -1; // interned label operand, if any
   int curPC;
   int64_t opcode;
   int64_t operand1;
@@ -42,9 +42,20 @@ bool isValidRange(int64_t num, Token::Kind kind) {
   return true;
 }
 
+// Labels are interned to dense IDs the first time they are seen, so the
+// symbol table is a vector of addresses indexed by label ID (-1 while a
+// label is still undefined).
+std::unordered_map<std::string, int> labelIds = {};
+std::vector<int> symbolTable = {};
+
+int internLabel(const std::string &name) {
+  auto id = labelIds.emplace(name, symbolTable.size());
+  if (id.second) symbolTable.push_back(-1);
+  return id.first->second;
+}
+
 int main() {
   std::vector<Instruction> instructions;
-  std::map<std::string, int> symbolTable = {};
   int PC = 0;
   std::string line;
 
@@ -59,11 +70,11 @@ int main() {
         std::string tokLexeme = tok.getLexeme();
 
         if (tokKind == Token::Kind::LABEL) {
-          std::string labelName = tokLexeme.substr(0, tokLexeme.size()-1);
-          if (symbolTable.find(labelName) != symbolTable.end()) {
+          int labelId = internLabel(tokLexeme.substr(0, tokLexeme.size()-1));
+          if (symbolTable[labelId] != -1) {
             throw ScanningFailure("ERROR");
           }
-          symbolTable[labelName] = PC;
+          symbolTable[labelId] = PC;
           continue;
         } else if (tokKind == Token::Kind::WORD) {
           if (tokenLine[i+1].getKind() == Token::Kind::INT ||
@@ -73,7 +84,7 @@ int main() {
             in.name = "word";
 
             if (tokenLine[i+1].getKind() == Token::Kind::ID) {
-              in.labelName = tokenLine[i+1].getLexeme();
+              in.labelId = internLabel(tokenLine[i+1].getLexeme());
             } else {
               if (isValidRange(tokenLine[i+1].toNumber(), 
                                Token::Kind::WORD) == false) {
@@ -165,7 +176,7 @@ int main() {
               in.name = tokLexeme;
               in.operand1 = tokenLine[i+1].toNumber();
               in.operand2 = tokenLine[i+3].toNumber();
-              in.labelName = tokenLine[i+5].getLexeme();
+              in.labelId = internLabel(tokenLine[i+5].getLexeme());
               instructions.push_back(in);
               i += 5;
               PC += 4;
@@ -260,16 +271,16 @@ int main() {
   // also checks range for offset, where applicable
   try {
     for (unsigned i = 0; i < instructions.size(); ++i) {
-      if (instructions[i].name == "word" && instructions[i].labelName != "") {
+      if (instructions[i].name == "word" && instructions[i].labelId != -1) {
         // e.g. .word label
-        if (symbolTable.find(instructions[i].labelName) == symbolTable.end()) {
+        if (symbolTable[instructions[i].labelId] == -1) {
           throw ScanningFailure("ERROR"); 
         }
-        if (isValidRange(symbolTable[instructions[i].labelName],
+        if (isValidRange(symbolTable[instructions[i].labelId],
                          Token::Kind::WORD) == false) {
           throw ScanningFailure("ERROR"); 
         }
-        instructions[i].instr = symbolTable[instructions[i].labelName];
+        instructions[i].instr = symbolTable[instructions[i].labelId];
       }
       if (instructions[i].name == "add" || instructions[i].name == "sub" ||
           instructions[i].name == "slt" || instructions[i].name == "sltu") {
@@ -284,12 +295,12 @@ int main() {
                                 instructions[i].opcode;                         
       }
       if (instructions[i].name == "beq" || instructions[i].name == "bne") {
-        if (instructions[i].labelName != "") {
+        if (instructions[i].labelId != -1) {
           // calculate difference betweem PC and label address for offset
-          if (symbolTable.find(instructions[i].labelName) == symbolTable.end()) {
+          if (symbolTable[instructions[i].labelId] == -1) {
             throw ScanningFailure("ERROR"); 
           }
-          int labelAddress = symbolTable[instructions[i].labelName];
+          int labelAddress = symbolTable[instructions[i].labelId];
           instructions[i].operand3 = (labelAddress-instructions[i].curPC-4) / 4;
           if (isValidRange(instructions[i].operand3, Token::Kind::INT) == false) {
             throw ScanningFailure("ERROR"); 
@@ -0,0 +1,91 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "../wlp4scanner.cc"
+
+/*
+ * Times keyword classification, keywordKind's perfect hash, against the
+ * chain of up to ten string comparisons it replaced, over lists of ID
+ * lexemes that are all keywords, all other identifiers, or a mix.
+ *
+ *   g++ -std=c++17 -O2 bench/bench_keywords.cc -o bench_keywords
+ */
+
+using Clock = std::chrono::steady_clock;
+
+volatile int sink; // keeps the passes from being optimized away
+
+// The classification before the perfect hash
+WLP4Token::Kind keywordChain(const std::string &lex) {
+  if (lex == "int") {
+    return WLP4Token::INT;
+  } else if (lex == "return") {
+    return WLP4Token::RETURN;
+  } else if (lex == "if") {
+    return WLP4Token::IF;
+  } else if (lex == "else") {
+    return WLP4Token::ELSE;
+  } else if (lex == "while") {
+    return WLP4Token::WHILE;
+  } else if (lex == "println") {
+    return WLP4Token::PRINTLN;
+  } else if (lex == "wain") {
+    return WLP4Token::WAIN;
+  } else if (lex == "new") {
+    return WLP4Token::NEW;
+  } else if (lex == "delete") {
+    return WLP4Token::DELETE;
+  } else if (lex == "NULL") {
+    return WLP4Token::NULL_;
+  }
+  return WLP4Token::ID;
+}
+
+// count lexemes, each a keyword with probability keywordShare and otherwise
+// an identifier of 1 to 12 letters and digits
+std::vector<std::string> makeLexemes(double keywordShare, size_t count) {
+  std::mt19937 rng{1};
+  std::uniform_real_distribution<double> coin;
+  const std::string alnum = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+  std::vector<std::string> lexemes;
+  while (lexemes.size() < count) {
+    if (coin(rng) < keywordShare) {
+      lexemes.emplace_back(KEYWORDS[rng() % size(KEYWORDS)].text);
+    } else {
+      std::string id(1, alnum[rng() % 52]);
+      for (size_t len = rng() % 12; len > 0; --len) id += alnum[rng() % alnum.size()];
+      lexemes.push_back(id);
+    }
+  }
+  return lexemes;
+}
+
+// Best of 5 passes over lexemes, in nanoseconds per lexeme
+template <typename Classify>
+double timeClassify(const std::vector<std::string> &lexemes, Classify &&classify) {
+  double best = 1e9;
+  int kinds = 0;
+  for (int rep = 0; rep < 5; ++rep) {
+    auto start = Clock::now();
+    for (const std::string &lex : lexemes) kinds += classify(lex);
+    std::chrono::duration<double, std::nano> took = Clock::now() - start;
+    best = std::min(best, took.count() / lexemes.size());
+  }
+  sink = kinds;
+  return best;
+}
+
+int main() {
+  const size_t COUNT = 1 << 22;
+  std::printf("lexemes      hash ns  chain ns  speedup\n");
+  for (double share : {1.0, 0.0, 0.4}) {
+    std::vector<std::string> lexemes = makeLexemes(share, COUNT);
+    double hash = timeClassify(lexemes, [](const std::string &lex) { return keywordKind(lex); });
+    double chain = timeClassify(lexemes, keywordChain);
+    const char *name = share == 1.0 ? "keywords" : share == 0.0 ? "identifiers" : "40% keywords";
+    std::printf("%-12s %7.2f  %8.2f  %6.2fx\n", name, hash, chain, chain / hash);
+  }
+}
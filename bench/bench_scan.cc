@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "../wlp4scanner.cc"
+
+/*
+ * Times the scanner's run-skipping kernels, whitespaceEnd and alnumEnd,
+ * against the scalar loops they replace, over buffers of runs with lengths
+ * drawn from 1 to a maximum, each followed by a byte that ends it. Built
+ * with -U__SSE2__ the kernels are the scalar loop, so the columns match.
+ *
+ *   g++ -std=c++17 -O2 bench/bench_scan.cc -o bench_scan
+ */
+
+using Clock = std::chrono::steady_clock;
+
+volatile size_t sink; // keeps the passes from being optimized away
+
+// Runs of bytes from run, each ended by stop, about size bytes in all
+std::string makeRuns(const std::string &run, char stop, size_t maxLen, size_t size) {
+  std::mt19937 rng{1};
+  std::string buf;
+  while (buf.size() < size) {
+    size_t len = 1 + rng() % maxLen;
+    for (size_t i = 0; i < len; ++i) buf += run[rng() % run.size()];
+    buf += stop;
+  }
+  return buf;
+}
+
+// Best of 5 passes over buf, in nanoseconds per byte
+template <typename RunEnd>
+double timeRuns(const std::string &buf, RunEnd &&runEnd) {
+  double best = 1e9;
+  size_t runs = 0;
+  for (int rep = 0; rep < 5; ++rep) {
+    auto start = Clock::now();
+    const char *end = buf.data() + buf.size();
+    for (const char *p = buf.data(); p < end; ++p) {
+      p = runEnd(p, end);
+      ++runs;
+    }
+    std::chrono::duration<double, std::nano> took = Clock::now() - start;
+    best = std::min(best, took.count() / buf.size());
+  }
+  sink = runs;
+  return best;
+}
+
+int main() {
+  const size_t SIZE = 1 << 24;
+  std::printf("kernel      max run  kernel ns/B  scalar ns/B  speedup\n");
+  for (size_t maxLen : {4, 16, 64, 256}) {
+    std::string ws = makeRuns(" \t\n", 'x', maxLen, SIZE);
+    std::string ids = makeRuns("abcxyzABC019", ' ', maxLen, SIZE);
+    double wsFast = timeRuns(ws, whitespaceEnd);
+    double wsSlow = timeRuns(ws, [](const char *p, const char *end) {
+      while (p != end && isWhitespace(*p)) ++p;
+      return p;
+    });
+    double idFast = timeRuns(ids, alnumEnd);
+    double idSlow = timeRuns(ids, [](const char *p, const char *end) {
+      while (p != end && isAlnum(*p)) ++p;
+      return p;
+    });
+    std::printf("whitespace  %7zu  %11.3f  %11.3f  %6.2fx\n", maxLen, wsFast, wsSlow, wsSlow / wsFast);
+    std::printf("alnum       %7zu  %11.3f  %11.3f  %6.2fx\n", maxLen, idFast, idSlow, idSlow / idFast);
+  }
+}
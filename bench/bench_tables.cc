@@ -0,0 +1,109 @@
+#include <cstdio>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "../wlp4tables.h"
+
+/*
+ * Times parse action lookups in the row-displaced BASE/CHECK/NEXT tables
+ * against the dense [state][symbol] table they replaced, which is rebuilt
+ * here from them. Lookups are made on random pairs that have an action, on
+ * any pairs, and along a random walk where each state is the result of the
+ * lookup before, as in a parse.
+ *
+ *   ./wlp4tablegen > wlp4tables.h
+ *   g++ -std=c++17 -O2 bench/bench_tables.cc -o bench_tables
+ */
+
+using namespace wlp4tables;
+using Clock = std::chrono::steady_clock;
+
+volatile int sink; // keeps the passes from being optimized away
+
+short DENSE[NUM_STATES][NUM_SYMBOLS];
+
+// The lookup in wlp4parser.cc
+inline int displaced(int state, int a) {
+  int i = BASE[state] + a;
+  return CHECK[i] == state ? NEXT[i] : 0;
+}
+
+inline int dense(int state, int a) { return DENSE[state][a]; }
+
+struct Pair {
+  short state, symbol;
+};
+
+// Best of 5 passes over pairs, in nanoseconds per lookup
+template <typename Action>
+double timePairs(const std::vector<Pair> &pairs, Action &&action) {
+  double best = 1e9;
+  int total = 0;
+  for (int rep = 0; rep < 5; ++rep) {
+    auto start = Clock::now();
+    for (const Pair &p : pairs) total += action(p.state, p.symbol);
+    std::chrono::duration<double, std::nano> took = Clock::now() - start;
+    best = std::min(best, took.count() / pairs.size());
+  }
+  sink = total;
+  return best;
+}
+
+// MOVES[s] lists the symbols that state s shifts or goes to on, repeated to
+// fill the row so that a walk picks one with a mask
+short MOVES[NUM_STATES][64];
+
+// Best of 5 walks, in nanoseconds per lookup. At each step the walk takes
+// the choice'th move of the state it is in.
+template <typename Action>
+double timeWalk(const std::vector<unsigned> &choices, Action &&action) {
+  double best = 1e9;
+  int state = 0;
+  for (int rep = 0; rep < 5; ++rep) {
+    auto start = Clock::now();
+    for (unsigned choice : choices) {
+      int next = action(state, MOVES[state][choice % 64]);
+      state = next > 0 ? next - 1 : 0;
+    }
+    std::chrono::duration<double, std::nano> took = Clock::now() - start;
+    best = std::min(best, took.count() / choices.size());
+  }
+  sink = state;
+  return best;
+}
+
+int main() {
+  std::vector<Pair> all, hits;
+  for (short s = 0; s < NUM_STATES; ++s) {
+    for (short a = 0; a < NUM_SYMBOLS; ++a) {
+      DENSE[s][a] = displaced(s, a);
+      all.push_back({s, a});
+      if (DENSE[s][a] != 0) hits.push_back({s, a});
+    }
+    // a state that only reduces ends the walk, which starts again at state 0
+    std::vector<short> moves;
+    for (short a = 0; a < NUM_SYMBOLS; ++a) {
+      if (DENSE[s][a] > 0) moves.push_back(a);
+    }
+    if (moves.empty()) moves.push_back(0);
+    for (int i = 0; i < 64; ++i) MOVES[s][i] = moves[i % moves.size()];
+  }
+
+  const size_t COUNT = 1 << 24;
+  std::mt19937 rng{1};
+  std::vector<Pair> hitPairs, anyPairs;
+  std::vector<unsigned> choices;
+  for (size_t i = 0; i < COUNT; ++i) {
+    hitPairs.push_back(hits[rng() % hits.size()]);
+    anyPairs.push_back(all[rng() % all.size()]);
+    choices.push_back(rng());
+  }
+
+  std::printf("tables: %zu bytes displaced, %zu bytes dense\n",
+              sizeof BASE + sizeof CHECK + sizeof NEXT, sizeof DENSE);
+  std::printf("lookups       displaced ns  dense ns\n");
+  std::printf("actions       %12.3f  %8.3f\n", timePairs(hitPairs, displaced), timePairs(hitPairs, dense));
+  std::printf("any pair      %12.3f  %8.3f\n", timePairs(anyPairs, displaced), timePairs(anyPairs, dense));
+  std::printf("parse walk    %12.3f  %8.3f\n", timeWalk(choices, displaced), timeWalk(choices, dense));
+}
@@ -0,0 +1,167 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "wlp4token.h"
+#include "wlp4scanner.h"
+#include "wlp4tree.h"
+#include "wlp4parser.h"
+#include "wlp4typechecker.h"
+#include "wlp4codegen.h"
+
+using namespace std;
+
+/*
+ * The whole compiler in one process: reads WLP4 source and writes MIPS
+ * assembly, as wlp4scan | wlp4parse | wlp4type | wlp4gen would, but tokens
+ * go from the scanner straight to the parser and the tree is handed from
+ * stage to stage in memory.
+ *
+ * --stop-after=scan, parse or type instead writes that stage's output, in
+ * the text form that wlp4scan, wlp4parse or wlp4type writes.
+ *
+ * --stream compiles a procedure at a time: each procedure is checked and
+ * its code written as soon as it is parsed, and then freed, so memory stays
+ * proportional to the largest procedure. The code jumps to wain first,
+ * since main comes last. Errors are reported at the first procedure that
+ * has one, after the code for the procedures before it has been written.
+ */
+
+enum Stage { SCAN, PARSE, TYPE, GEN };
+
+// Scans the source on stdin a chunk at a time, so that only the token being
+// munched is held between chunks, and passes each token to visit until it
+// returns false. Returns false if the scanner rejects the source first.
+template <typename Visit>
+bool scanInput(Visit &&visit) {
+  const size_t CHUNK_SIZE = 1 << 16;
+  vector<char> chunk(CHUNK_SIZE);
+  TokenScanner scanner;
+  vector<ScannedToken> tokens;
+  while (!scanner.state().rejected) {
+    cin.read(chunk.data(), chunk.size());
+    streamsize len = cin.gcount();
+    if (len == 0) break;
+    scanner.feed(chunk.data(), chunk.data() + len, tokens);
+    for (auto &tok : tokens) {
+      if (!visit(tok)) return true;
+    }
+    tokens.clear();
+  }
+  bool accepted = scanner.finish(tokens);
+  for (auto &tok : tokens) {
+    if (!visit(tok)) return true;
+  }
+  return accepted;
+}
+
+// Writes each token as a "KIND lexeme" line, as wlp4scan does
+int scanOnly() {
+  bool accepted = scanInput([](ScannedToken &tok) {
+    if (numInRange(tok)) {
+      cout << WLP4Token::kindName(tok.kind) << " " << tok.lexeme << '\n';
+    } else {
+      cerr << "ERROR" << endl;
+    }
+    return true;
+  });
+  if (!accepted) {
+    cerr << "ERROR" << endl;
+  }
+  return 0;
+}
+
+const char *const USAGE = "usage: wlp4c [--stop-after=scan|parse|type | --stream]";
+
+int main(int argc, char *argv[]) {
+  ios_base::sync_with_stdio(false);
+
+  Stage last = GEN;
+  bool streaming = false;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--stop-after=scan") == 0) {
+      last = SCAN;
+    } else if (strcmp(argv[i], "--stop-after=parse") == 0) {
+      last = PARSE;
+    } else if (strcmp(argv[i], "--stop-after=type") == 0) {
+      last = TYPE;
+    } else if (strcmp(argv[i], "--stream") == 0) {
+      streaming = true;
+    } else {
+      cerr << USAGE << endl;
+      return 1;
+    }
+  }
+  if (streaming && last != GEN) {
+    cerr << USAGE << endl;
+    return 1;
+  }
+  if (last == SCAN) return scanOnly();
+
+  // With --stream, each procedure is checked and its code written as soon
+  // as it is parsed, and then freed
+  WLP4Parser parser;
+  bool illTyped = false;
+  if (streaming) {
+    startTypeCheck();
+    startCode();
+    parser.streamProcedures([&illTyped](TreeStream &&proc) {
+      if (illTyped) return;
+      FlatTree tree{move(proc)};
+      if (typeCheckProcedure(tree)) {
+        generateProcedureCode(tree);
+      } else {
+        illTyped = true;
+      }
+    });
+  }
+
+  // the parser takes tokens from the scanner as they are munched
+  bool stopped = false; // by an error before the end of the source
+  bool accepted = scanInput([&](ScannedToken &tok) {
+    if (!numInRange(tok)) {
+      cerr << "ERROR" << endl;
+    } else if (!parser.push({tok.kind, move(tok.lexeme)})) {
+      cerr << "ERROR at " << parser.numShifts() << endl;
+    } else if (illTyped) {
+      cerr << "ERROR" << endl;
+    } else {
+      return true;
+    }
+    stopped = true;
+    return false;
+  });
+  if (stopped) return 1;
+  if (!accepted) {
+    cerr << "ERROR" << endl;
+    return 1;
+  }
+  if (!parser.finish()) {
+    cerr << "ERROR at " << parser.numShifts() << endl;
+    return 1;
+  }
+  if (streaming) {
+    if (illTyped) {
+      cerr << "ERROR" << endl;
+      return 1;
+    }
+    return 0;
+  }
+  if (last == PARSE) {
+    parser.printTree(cout);
+    return 0;
+  }
+
+  FlatTree tree{parser.tree()};
+  if (!typeCheck(tree)) {
+    cerr << "ERROR" << endl;
+    return 1;
+  }
+  if (last == TYPE) {
+    printTypedTree(tree, cout);
+    return 0;
+  }
+
+  generateCode(tree);
+  return 0;
+}
@@ -0,0 +1,578 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <string_view>
+#include "wlp4tables.h"
+#include "wlp4tree.h"
+#include "wlp4codegen.h"
+
+using namespace std;
+using namespace wlp4tables;
+
+namespace {
+
+typedef TreeStream::Type Type;
+const Type UNTYPED = TreeStream::UNTYPED, INT = TreeStream::INT, INT_STAR = TreeStream::INT_STAR;
+
+// The tree being compiled. Identifiers are numbered by their interned
+// lexeme, so the offset table is indexed by that instead of keyed by name.
+const FlatTree *tree;
+
+// A node of tree, by number
+typedef TreeNode<const FlatTree, &tree> SymTree;
+
+vector<int> offsetTable; // indexed by symbol ID
+int varCount = 0; // this is for non-parameter variables (wain and other procs)
+// parameters are dealt with in the general cases for "main" and "procedure"
+int ifCount = 0;
+int whileCount = 0;
+int delCount = 0;
+
+void push(string reg) {
+  cout << "sw $" + reg + ", -4($30)" << '\n';
+  cout << "sub $30, $30, $4" << '\n'; 
+}
+void pop(string reg) {
+  cout << "add $30, $30, $4" << '\n';
+  cout << "lw $" + reg + ", -4($30)" << '\n';
+}
+void lis(string reg, string word) {
+  // lis $reg
+  // .word ___
+  cout << "lis $" + reg << '\n';
+  cout << ".word " + word << '\n';
+}
+void loadVar(string reg, string offset) {
+  // lw $reg, offset($29)
+  cout << "lw $" + reg + ", " + offset + "($29)" << '\n';
+}
+void jalr(string reg) {
+  cout << "jalr $" + reg << '\n';
+}
+void imports() {
+  cout << ".import init" << '\n';
+  cout << ".import new" << '\n';
+  cout << ".import delete" << '\n';
+  cout << ".import print" << '\n';
+}
+// Sets up the registers and the heap on entry to wain
+void initWain(SymTree wain) {
+  lis("4", "4");
+  lis("11", "1");
+  push("2");
+  push("31");
+  // if 1st param in wain is int, set $2 = 0
+  if (wain.child(at::main::dcl).child(at::dcl::type).prod() == type_INT) {
+    lis("2", "0");
+  }
+  lis("5", "init");
+  jalr("5");
+  pop("31");
+  pop("2");
+  cout << "sub $29, $30, $4" << '\n';
+}
+void init(SymTree root) {
+  imports();
+  SymTree procs = root.child(at::start::procedures);
+  while (procs.prod() == procedures_procedure_procedures) {
+    procs = procs.child(at::procedures::procedures);
+  }
+  initWain(procs.child(at::procedures::main));
+}
+
+void processParams(SymTree params) { // doesnt gen code but updates offset table
+  // calculate number of parameters
+  int pCount = 0;
+  vector<int> pStack;
+  if (params.prod() == params_paramlist) {
+    SymTree paramlist = params.child(at::params::paramlist);
+    while (paramlist.prod() == paramlist_dcl_COMMA_paramlist) {
+      ++pCount;
+      pStack.push_back(paramlist.child(at::paramlist::dcl).child(at::dcl::ID).symId());
+      paramlist = paramlist.child(at::paramlist::paramlist);
+    }
+    // have paramlist -> dcl
+    ++pCount;
+    pStack.push_back(paramlist.child(at::paramlist::dcl).child(at::dcl::ID).symId());
+  }
+  // then update offset table
+  for (int i = 1; i <= pCount; ++i) {
+    offsetTable[pStack.at(i-1)] = 4 * (pCount - i + 1);
+  }
+}
+
+void code(SymTree root);
+
+// Checks whether root is a binary expr or term node whose left operand is
+// evaluated first, which is all of them except int + int*
+bool isLeftFirst(SymTree root) {
+  switch (root.prod()) {
+  case expr_expr_PLUS_term:
+    return root.child(at::expr_expr_PLUS_term::expr).type() != INT || root.child(at::expr_expr_PLUS_term::term).type() == INT;
+  case expr_expr_MINUS_term:
+  case term_term_STAR_factor:
+  case term_term_SLASH_factor:
+  case term_term_PCT_factor:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// The left operand of a binary expr or term node
+SymTree leftOperand(SymTree root) {
+  switch (root.prod()) {
+  case expr_expr_PLUS_term: return root.child(at::expr_expr_PLUS_term::expr);
+  case expr_expr_MINUS_term: return root.child(at::expr_expr_MINUS_term::expr);
+  case term_term_STAR_factor: return root.child(at::term_term_STAR_factor::term);
+  case term_term_SLASH_factor: return root.child(at::term_term_SLASH_factor::term);
+  default: return root.child(at::term_term_PCT_factor::term);
+  }
+}
+
+// Given the left operand of root in $3, evaluates the right operand and
+// applies root's operator
+void codeRightOperand(SymTree root) {
+  push("3");
+  switch (root.prod()) {
+  case expr_expr_PLUS_term:
+    code(root.child(at::expr_expr_PLUS_term::term));
+    if (root.child(at::expr_expr_PLUS_term::expr).type() == INT_STAR) {
+      // int* + int
+      cout << "mult $3, $4" << '\n';
+      cout << "mflo $3" << '\n';
+    }
+    pop("5");
+    cout << "add $3, $5, $3" << '\n';
+    break;
+  case expr_expr_MINUS_term: {
+    Type left = root.child(at::expr_expr_MINUS_term::expr).type(), right = root.child(at::expr_expr_MINUS_term::term).type();
+    code(root.child(at::expr_expr_MINUS_term::term));
+    if (left == INT_STAR && right == INT) {
+      // int* - int
+      cout << "mult $3, $4" << '\n';
+      cout << "mflo $3" << '\n';
+    }
+    pop("5");
+    cout << "sub $3, $5, $3" << '\n';
+    if (right != INT) {
+      // int* - int*
+      cout << "div $3, $4" << '\n';
+      cout << "mflo $3" << '\n';
+    }
+    break;
+  }
+  case term_term_STAR_factor:
+    code(root.child(at::term_term_STAR_factor::factor));
+    pop("5");
+    cout << "mult $5, $3" << '\n';
+    cout << "mflo $3" << '\n';
+    break;
+  case term_term_SLASH_factor:
+    code(root.child(at::term_term_SLASH_factor::factor));
+    pop("5");
+    cout << "div $5, $3" << '\n';
+    cout << "mflo $3" << '\n';
+    break;
+  case term_term_PCT_factor:
+    code(root.child(at::term_term_PCT_factor::factor));
+    pop("5");
+    cout << "div $5, $3" << '\n';
+    cout << "mfhi $3" << '\n';
+    break;
+  }
+}
+
+// Declares one local variable with its initial value; root is a
+// non-empty dcls node
+void codeDcl(SymTree root) {
+  int varId = root.child(at::dcls::dcl).child(at::dcl::ID).symId();
+  offsetTable[varId] = varCount * -4;
+  ++varCount;
+  // store initial value (use $3) instead of $1 and $2, and push
+  if (root.prod() == dcls_dcls_dcl_BECOMES_NUM_SEMI) {
+    lis("3", string(root.child(at::dcls::NUM).lexeme()));
+  } else {
+    lis("3", "1"); // 1 is the NULL constant
+  }
+  push("3");
+}
+
+void code(SymTree root) {
+  switch (root.prod()) {
+  case procedures_procedure_procedures:
+  case procedures_main: {
+    vector<SymTree > procStack;
+    SymTree procs = root;
+    while (procs.prod() != procedures_main) {
+      procStack.push_back(procs.child(at::procedures::procedure));
+      procs = procs.child(at::procedures::procedures);
+    }
+    // now we have procedures -> main
+    // print main FIRST, then procedure in order of appearance
+    code(procs.child(at::procedures::main));
+    for (unsigned i = 0; i < procStack.size(); ++i) {
+      code(procStack.at(i));
+    }
+    return;
+  }
+  case main_INT_WAIN_LPAREN_dcl_COMMA_dcl_RPAREN_LBRACE_dcls_statements_RETURN_expr_SEMI_RBRACE: {
+    // note: we already init'd in main
+    int varId = root.child(at::main::dcl).child(at::dcl::ID).symId();
+    offsetTable[varId] = varCount * -4;
+    ++varCount;
+    push("1");
+
+    varId = root.child(at::main::dcl2).child(at::dcl::ID).symId();
+    offsetTable[varId] = varCount * -4;
+    ++varCount;
+    push("2");
+
+    code(root.child(at::main::dcls));
+    code(root.child(at::main::statements));
+    code(root.child(at::main::expr));
+    cout << "jr $31" << '\n';
+    return;
+  }
+  case procedure_INT_ID_LPAREN_params_RPAREN_LBRACE_dcls_statements_RETURN_expr_SEMI_RBRACE: {
+    cout << "F" << root.child(at::procedure::ID).lexeme() << ":" << '\n';
+    cout << "sub $29, $30, $4" << '\n'; // set the frame pointer
+
+    processParams(root.child(at::procedure::params));
+    // get number of non-parameter local vars
+    SymTree dcls = root.child(at::procedure::dcls);
+    int locVarCount = 0;
+    while (dcls.prod() != dcls_EMPTY) {
+      ++locVarCount;
+      dcls = dcls.child(at::dcls::dcls);
+    }
+
+    varCount = 0; // first non-parameter starts at offset 0!
+    code(root.child(at::procedure::dcls)); // push non-parameter local variables (same as wain)
+    code(root.child(at::procedure::statements)); 
+    code(root.child(at::procedure::expr));
+
+    // Generate code that pops non-parameter local variables
+    for (int i = 0; i < locVarCount; ++i) {
+      cout << "add $30, $30, $4" << '\n';
+    }
+    cout << "jr $31" << '\n';
+    return;
+  }
+  case expr_term:
+    code(root.child(at::expr_term::term));
+    return;
+  case term_factor:
+    code(root.child(at::term_factor::factor));
+    return;
+  case factor_LPAREN_expr_RPAREN:
+    code(root.child(at::factor_LPAREN_expr_RPAREN::expr));
+    return;
+  case factor_ID: {
+    int offset = offsetTable[root.child(at::factor::ID).symId()];
+    loadVar("3", to_string(offset));
+    return;
+  }
+  case factor_NUM: {
+    string num{root.child(at::factor::NUM).lexeme()};
+    lis("3", num);
+    return;
+  }
+  // Q1++ function calls
+  case factor_ID_LPAREN_RPAREN:
+    push("29");
+    push("31");
+    lis("5", "F" + string(root.child(at::factor::ID).lexeme()));
+    jalr("5");
+    pop("31");
+    pop("29");
+    return;
+  case factor_ID_LPAREN_arglist_RPAREN: {
+    push("29");
+    push("31");
+    int numArgs = 0;
+    SymTree arglist = root.child(at::factor::arglist);
+    while (true) {
+      // arglist -> expr COMMA arglist OR arglist -> expr
+      ++numArgs;
+      code(arglist.child(at::arglist::expr));
+      push("3");
+      if (arglist.prod() == arglist_expr) break;
+      arglist = arglist.child(at::arglist::arglist);
+    }
+    lis("5", "F" + string(root.child(at::factor::ID).lexeme()));
+    jalr("5");
+    for (int i = 0; i < numArgs; ++i) {
+      // pop and discard each argument from the stack
+      cout << "add $30, $30, $4" << '\n';
+    }
+    pop("31");
+    pop("29");
+    return;
+  }
+
+  // Q2
+  case dcls_EMPTY:
+  case dcls_dcls_dcl_BECOMES_NUM_SEMI:
+  case dcls_dcls_dcl_BECOMES_NULL_SEMI: {
+    // dcls is left-recursive; code the declarations in source order
+    vector<SymTree > decls;
+    for (SymTree dcls = root; dcls.prod() != dcls_EMPTY; dcls = dcls.child(at::dcls::dcls)) {
+      decls.push_back(dcls);
+    }
+    for (size_t i = decls.size(); i-- > 0;) codeDcl(decls[i]);
+    return;
+  }
+  case statements_EMPTY:
+  case statements_statements_statement: {
+    // statements is left-recursive too
+    vector<SymTree > stmts;
+    for (SymTree stmtList = root; stmtList.prod() != statements_EMPTY; stmtList = stmtList.child(at::statements::statements)) {
+      stmts.push_back(stmtList.child(at::statements::statement));
+    }
+    for (size_t i = stmts.size(); i-- > 0;) code(stmts[i]);
+    return;
+  }
+  case statement_lvalue_BECOMES_expr_SEMI: {
+    SymTree expr = root.child(at::statement_lvalue_BECOMES_expr_SEMI::expr);
+    SymTree lvalue = root.child(at::statement_lvalue_BECOMES_expr_SEMI::lvalue);
+    while (lvalue.prod() == lvalue_LPAREN_lvalue_RPAREN) {
+      lvalue = lvalue.child(at::lvalue::lvalue);
+    }
+    if (lvalue.prod() == lvalue_ID) {
+      // code for assignment to a variable
+      code(root.child(at::statement_lvalue_BECOMES_expr_SEMI::expr));
+      int offset = offsetTable[lvalue.child(at::lvalue::ID).symId()];
+      cout << "sw $3, " + to_string(offset) + "($29)" << '\n';
+    } else if (lvalue.prod() == lvalue_STAR_factor) {
+      // code for assignment to a dereferenced pointer (Q2++)
+      code(expr);
+      push("3");
+      code(lvalue.child(at::lvalue::factor));
+      pop("5");
+      cout << "sw $5, 0($3)" << '\n';
+    }
+    return;
+  }
+  // Q2++
+  case factor_NULL:
+    lis("3", "1");
+    return;
+  case factor_STAR_factor:
+    code(root.child(at::factor::factor));
+    cout << "lw $3, 0($3)" << '\n';
+    return;
+  case factor_AMP_lvalue: {
+    SymTree lvalue = root.child(at::factor::lvalue);
+    if (lvalue.prod() == lvalue_ID) {
+      int offset = offsetTable[lvalue.child(at::lvalue::ID).symId()];
+      lis("3", to_string(offset));
+      cout << "add $3, $29, $3" << '\n';
+    } else if (lvalue.prod() == lvalue_STAR_factor) {
+      code(lvalue.child(at::lvalue::factor)); // &*e is e
+    }
+    return;
+  }
+
+  // Q3 / Q3++
+  case expr_expr_PLUS_term:
+  case expr_expr_MINUS_term:
+  case term_term_STAR_factor:
+  case term_term_SLASH_factor:
+  case term_term_PCT_factor: {
+    if (!isLeftFirst(root)) {
+      // int + int*
+      code(root.child(at::expr_expr_PLUS_term::term));
+      push("3");
+      code(root.child(at::expr_expr_PLUS_term::expr));
+      cout << "mult $3, $4" << '\n';
+      cout << "mflo $3" << '\n';
+      pop("5");
+      cout << "add $3, $5, $3" << '\n';
+      return;
+    }
+    // expr and term chains are left-recursive: walk down the chain, then
+    // apply the operators from the innermost out
+    vector<SymTree> chain;
+    for (SymTree t = root; isLeftFirst(t); t = leftOperand(t)) chain.push_back(t);
+    code(leftOperand(chain.back()));
+    for (size_t i = chain.size(); i-- > 0;) codeRightOperand(chain[i]);
+    return;
+  }
+
+  // Q4 / Q4++
+  case test_expr_NE_expr:
+    code(root.child(at::test::expr));
+    push("3");
+    code(root.child(at::test::expr2));
+    pop("5");
+    if (root.child(at::test::expr).type() == INT) {
+      cout << "slt $6, $3, $5" << '\n';
+      cout << "slt $7, $5, $3" << '\n';
+    } else {
+      cout << "sltu $6, $3, $5" << '\n';
+      cout << "sltu $7, $5, $3" << '\n';
+    }
+    cout << "add $3, $6, $7" << '\n';
+    return;
+  case test_expr_EQ_expr:
+    code(root.child(at::test::expr));
+    push("3");
+    code(root.child(at::test::expr2));
+    pop("5");
+    if (root.child(at::test::expr).type() == INT) {
+      cout << "slt $6, $3, $5" << '\n';
+      cout << "slt $7, $5, $3" << '\n';
+    } else {
+      cout << "sltu $6, $3, $5" << '\n';
+      cout << "sltu $7, $5, $3" << '\n';
+    }
+    cout << "add $3, $6, $7" << '\n';
+    // invert:
+    cout << "sub $3, $11, $3" << '\n';
+    return;
+  case test_expr_LT_expr:
+    code(root.child(at::test::expr));
+    push("3");
+    code(root.child(at::test::expr2));
+    pop("5");
+    if (root.child(at::test::expr).type() == INT) {
+      cout << "slt $3, $5, $3" << '\n';
+    } else {
+      cout << "sltu $3, $5, $3" << '\n';
+    }
+    return;
+  case test_expr_GE_expr:
+    code(root.child(at::test::expr));
+    push("3");
+    code(root.child(at::test::expr2));
+    pop("5");
+    if (root.child(at::test::expr).type() == INT) {
+      cout << "slt $3, $5, $3" << '\n';
+    } else {
+      cout << "sltu $3, $5, $3" << '\n';
+    }
+    // invert:
+    cout << "sub $3, $11, $3" << '\n';
+    return;
+  case test_expr_GT_expr:
+    code(root.child(at::test::expr));
+    push("3");
+    code(root.child(at::test::expr2));
+    pop("5");
+    if (root.child(at::test::expr).type() == INT) {
+      cout << "slt $3, $3, $5" << '\n';
+    } else {
+      cout << "sltu $3, $3, $5" << '\n';
+    }
+    return;
+  case test_expr_LE_expr:
+    code(root.child(at::test::expr));
+    push("3");
+    code(root.child(at::test::expr2));
+    pop("5");
+    if (root.child(at::test::expr).type() == INT) {
+      cout << "slt $3, $3, $5" << '\n';
+    } else {
+      cout << "sltu $3, $3, $5" << '\n';
+    }
+    // invert:
+    cout << "sub $3, $11, $3" << '\n';
+    return;
+  case statement_IF_LPAREN_test_RPAREN_LBRACE_statements_RBRACE_ELSE_LBRACE_statements_RBRACE: {
+    ++ifCount;
+    string strCount = to_string(ifCount);
+
+    code(root.child(at::statement::test));
+    cout << "beq $3, $0, else" + strCount << '\n';
+    code(root.child(at::statement::statements));
+    cout << "beq $0, $0, endif" + strCount << '\n';
+    cout << "else" + strCount + ":" << '\n';
+    code(root.child(at::statement::statements2));
+    cout << "endif" + strCount + ":" << '\n';
+    return;
+  }
+  case statement_WHILE_LPAREN_test_RPAREN_LBRACE_statements_RBRACE: {
+    ++whileCount;
+    string strCount = to_string(whileCount);
+
+    cout << "loop" + strCount + ":" << '\n';
+    code(root.child(at::statement::test));
+    cout << "beq $3, $0, endWhile" + strCount << '\n';
+    code(root.child(at::statement::statements));
+    cout << "beq $0, $0, loop" + strCount << '\n';
+    cout << "endWhile" + strCount + ":" << '\n';
+    return;
+  }
+
+  // Q5
+  case statement_PRINTLN_LPAREN_expr_RPAREN_SEMI:
+    code(root.child(at::statement_PRINTLN_LPAREN_expr_RPAREN_SEMI::expr));
+    cout << "add $1, $3, $0" << '\n';
+    push("31");
+    lis("5", "print");
+    jalr("5");
+    pop("31");
+    return;
+  // Q5++
+  case factor_NEW_INT_LBRACK_expr_RBRACK:
+    code(root.child(at::factor_NEW_INT_LBRACK_expr_RBRACK::expr));
+    cout << "add $1, $3, $0" << '\n'; // place the size value in the parameter register
+    push("31");
+    lis("5", "new");
+    jalr("5");
+    pop("31");
+    cout << "bne $3, $0, 1" << '\n'; // skip the next instruction if "new" was successful
+    cout << "add $3, $11, $0" << '\n'; // set $3 = NULL if "new" failed, assuming $11 contains 1
+    return;
+  case statement_DELETE_LBRACK_RBRACK_expr_SEMI: {
+    ++delCount;
+    string strCount = to_string(delCount);
+    code(root.child(at::statement_DELETE_LBRACK_RBRACK_expr_SEMI::expr));
+    cout << "beq $3, $11, skipDelete" + strCount << '\n'; // skip if $3 = NULL
+    cout << "add $1, $3, $0" << '\n'; // place the address to delete in the parameter register
+    push("31");
+    lis("5", "delete");
+    jalr("5");
+    pop("31");
+    cout << "skipDelete" + strCount + ":" << '\n';
+    return;
+  }
+  }
+
+  // recurse on subtrees
+  for (size_t k = 0; k < root.numChildren(); ++k) {
+    code(root.child(k));
+  }
+}
+
+}
+
+void generateCode(const FlatTree &t) {
+  tree = &t;
+  offsetTable.assign(t.lexemes.size(), 0);
+  varCount = ifCount = whileCount = delCount = 0;
+  SymTree pt{0};
+  init(pt);
+  code(pt);
+}
+
+void startCode() {
+  varCount = ifCount = whileCount = delCount = 0;
+  imports();
+  // wain comes last, so the program starts with a jump to it
+  lis("5", "wain");
+  cout << "jr $5" << '\n';
+}
+
+void generateProcedureCode(const FlatTree &t) {
+  tree = &t;
+  offsetTable.assign(t.lexemes.size(), 0);
+  varCount = 0;
+  SymTree root{0};
+  if (root.prod() == main_INT_WAIN_LPAREN_dcl_COMMA_dcl_RPAREN_LBRACE_dcls_statements_RETURN_expr_SEMI_RBRACE) {
+    cout << "wain:" << '\n';
+    initWain(root);
+  }
+  code(root);
+}
@@ -0,0 +1,25 @@
+#ifndef WLP4CODEGEN_H
+#define WLP4CODEGEN_H
+#include "wlp4tree.h"
+
+/*
+ * The WLP4 code generator as a library; wlp4gen and wlp4c are drivers
+ * around it.
+ *
+ * Variables live in the frame at $29, the stack grows down from $30, and
+ * every expression leaves its value in $3.
+ */
+
+// Writes MIPS assembly for a typed, well-typed program to standard output
+void generateCode(const FlatTree &tree);
+
+/* Writes the code for a program one procedure at a time, for a compile that
+ * streams procedures from the parser. startCode writes the imports and a jump
+ * to the label wain, and then each procedure and finally main is written in
+ * order, each from a tree of its own rooted at its procedure or main node.
+ * Code for main starts at wain with what a whole-program compile does first.
+ */
+void startCode();
+void generateProcedureCode(const FlatTree &tree);
+
+#endif
@@ -0,0 +1,369 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <functional>
+#include "wlp4tables.h"
+#include "wlp4token.h"
+#include "wlp4tree.h"
+#include "wlp4parser.h"
+#include "arena.h"
+
+using namespace std;
+
+// Returns the symbol number of a terminal, or NUM_SYMBOLS if kind is not one
+int terminalId(const string &kind) {
+  using namespace wlp4tables;
+  for (int sym = 0; sym < NUM_TERMINALS; ++sym) {
+    if (kind == SYMBOLS[sym]) return sym;
+  }
+  return NUM_SYMBOLS;
+}
+
+namespace {
+
+// Nodes are allocated from the compilation's Arena. Symbol names and rules
+// point into the generated tables and lexemes into the arena.
+struct SymTree {
+  string_view symbol = "";
+  Span<SymTree *> children;
+
+  bool leaf;
+  int id; // the production of an interior node, or a leaf's terminal symbol
+  string_view lexeme;
+  string_view prodRule;
+};
+
+// Returns the action in state on symbol a, encoded as in NEXT, or 0 if
+// there is none
+inline int action(int state, int a) {
+  using namespace wlp4tables;
+  if (a >= NUM_SYMBOLS) return 0;
+  int i = BASE[state] + a;
+  return CHECK[i] == state ? NEXT[i] : 0;
+}
+
+/* wlp4parse --trace writes each shift and reduce to stderr. Steps are
+ * recorded as fixed-size events in a buffer and only rendered as text a
+ * batch at a time, when the buffer fills or the parse ends, so tracing costs
+ * a constant amount per step however deep the stack gets. An event points at
+ * the node that was pushed, whose strings live as long as the arena.
+ */
+class ParseTrace {
+  struct Event {
+    const SymTree *node; // the leaf shifted or the node reduced to
+    int state;           // the state pushed with it
+  };
+  static constexpr size_t CAPACITY = 1 << 12;
+  vector<Event> events;
+  size_t count = 0;
+ public:
+  ParseTrace(bool enabled) : events(enabled ? CAPACITY : 0) {}
+
+  void record(const SymTree *node, int state) {
+    if (events.empty()) return;
+    events[count++] = {node, state};
+    if (count == CAPACITY) flush();
+  }
+
+  // Renders the events recorded since the last flush
+  void flush() {
+    string text;
+    for (size_t i = 0; i < count; ++i) {
+      const SymTree *node = events[i].node;
+      text += node->leaf ? "shift " : "reduce ";
+      text += node->symbol;
+      text += node->leaf ? " " : " -> ";
+      text += node->leaf ? node->lexeme : node->prodRule;
+      text += " [" + to_string(events[i].state) + "]\n";
+    }
+    cerr << text;
+    count = 0;
+  }
+};
+
+// Prints the tree in preorder, using an explicit stack since the tree is as
+// deep as the longest statement or declaration list
+void printParseTree(SymTree *root, ostream &out) {
+  vector<SymTree *> stack = {root};
+  while (!stack.empty()) {
+    SymTree *t = stack.back();
+    stack.pop_back();
+    out << t->symbol;
+    if (t->leaf == true) {
+      out << " " << t->lexeme << '\n';
+    } else {
+      out << " " << t->prodRule << '\n';
+    }
+    for (size_t i = t->children.size(); i-- > 0;) stack.push_back(t->children[i]);
+  }
+}
+
+// Copies the tree into a TreeStream
+TreeStream streamParseTree(SymTree *root) {
+  // the tree's number for each terminal symbol of the tables
+  vector<TreeStream::Terminal> terminals(wlp4tables::NUM_TERMINALS);
+  for (int sym = 0; sym < wlp4tables::NUM_TERMINALS; ++sym) {
+    TreeStream::terminalFor(wlp4tables::SYMBOLS[sym], terminals[sym]);
+  }
+  TreeWriter out;
+  vector<SymTree *> stack = {root};
+  while (!stack.empty()) {
+    SymTree *t = stack.back();
+    stack.pop_back();
+    if (t->leaf) {
+      out.leaf(terminals[t->id], t->lexeme, TreeStream::UNTYPED);
+    } else {
+      out.interior(t->id, t->children.size(), TreeStream::UNTYPED);
+    }
+    for (size_t i = t->children.size(); i-- > 0;) stack.push_back(t->children[i]);
+  }
+  return out.take();
+}
+
+SymTree *mergeIntoOne(const vector<SymTree *> &symStack, Arena &arena) {
+  SymTree *t = arena.make<SymTree>();
+  t->symbol = "start";
+  t->children = {arena.makeArray<SymTree *>(3), 3};
+  t->children[0] = symStack[0];
+  t->children[1] = symStack[1];
+  t->children[2] = symStack[2];
+  t->leaf = false;
+  t->id = productionId("start", "BOF procedures EOF");
+  t->prodRule = wlp4tables::PRODUCTIONS[t->id].RHS;
+  return t;
+}
+
+// The state of an LR parse: the symbols shifted or reduced to so far, and
+// the states they took the parser to. Nodes are allocated from arena.
+struct Parser {
+  Arena &arena;
+  ParseTrace &trace;
+  vector<SymTree *> symStack = {};
+  vector<int> stateStack = {0};
+  int numShifts = 0;
+  // if set, called just after each procedure or main node is reduced
+  function<void()> onProcedure;
+
+  Parser(Arena &arena, ParseTrace &trace) : arena{arena}, trace{trace} {}
+
+  // Makes every reduction called for on lookahead a, and returns the action
+  // that follows: a shift, or 0 if a is an error here
+  int reduce(int a) {
+    int act;
+    while ((act = action(stateStack.back(), a)) < 0) {
+      // reduce: the top arity symbols become the children of a new LHS node
+      const wlp4tables::Production &prod = wlp4tables::PRODUCTIONS[-act - 1];
+      size_t base = symStack.size() - prod.arity;
+      SymTree *newSymTree = arena.make<SymTree>();
+      newSymTree->symbol = wlp4tables::SYMBOLS[prod.LHS];
+      newSymTree->children = {arena.makeArray<SymTree *>(prod.arity), size_t(prod.arity)};
+      copy(symStack.begin() + base, symStack.end(), newSymTree->children.begin());
+      newSymTree->leaf = false;
+      newSymTree->id = -act - 1;
+      newSymTree->prodRule = prod.RHS;
+      symStack.resize(base);
+      stateStack.resize(base + 1);
+      symStack.push_back(newSymTree);
+      stateStack.push_back(action(stateStack.back(), prod.LHS) - 1);
+      trace.record(newSymTree, stateStack.back());
+      using namespace wlp4tables;
+      if (onProcedure &&
+          (newSymTree->id == procedure_INT_ID_LPAREN_params_RPAREN_LBRACE_dcls_statements_RETURN_expr_SEMI_RBRACE ||
+           newSymTree->id == main_INT_WAIN_LPAREN_dcl_COMMA_dcl_RPAREN_LBRACE_dcls_statements_RETURN_expr_SEMI_RBRACE)) {
+        onProcedure();
+      }
+    }
+    return act;
+  }
+
+  // Reduces on tok and then shifts it. Returns false if tok is an error.
+  bool push(const Token &tok) {
+    int act = reduce(tok.symbol);
+    if (act == 0) return false;
+    SymTree *shiftedSymTree = arena.make<SymTree>();
+    shiftedSymTree->symbol = wlp4tables::SYMBOLS[tok.symbol];
+    shiftedSymTree->leaf = true;
+    shiftedSymTree->id = tok.symbol;
+    shiftedSymTree->lexeme = arena.copy(tok.lexeme);
+    symStack.push_back(shiftedSymTree);
+    ++numShifts;
+    stateStack.push_back(act - 1);
+    trace.record(shiftedSymTree, stateStack.back());
+    return true;
+  }
+};
+
+/* Parallel parsing (-j N).
+ * Every procedure, main included, is INT ID LPAREN ... RBRACE with its body
+ * the only braces at depth 0, so a prescan of brace depth splits the tokens
+ * into procedures. procedures is right-recursive, so each procedure is parsed
+ * in the same states whether it follows BOF or another procedure: a procedure
+ * parsed on its own just after BOF, with the first token of the next one as
+ * lookahead, reduces to the same subtree as in a sequential parse. The
+ * procedures are parsed on N threads and the procedures spine is then built
+ * over them.
+ *
+ * If any procedure fails to parse, the result is null and the caller parses
+ * sequentially, so that errors are reported at the same token.
+ */
+vector<size_t> procedureBounds(const vector<Token> &tokens) {
+  vector<size_t> bounds = {0};
+  int depth = 0;
+  for (size_t i = 0; i + 1 < tokens.size(); ++i) {
+    if (tokens[i].symbol == WLP4Token::LBRACE) {
+      ++depth;
+    } else if (tokens[i].symbol == WLP4Token::RBRACE && --depth == 0) {
+      bounds.push_back(i + 1);
+    }
+  }
+  bounds.push_back(tokens.size());
+  return bounds;
+}
+
+SymTree *parseProcedures(const vector<Token> &tokens, unsigned jobs, Arena &arena,
+                         vector<unique_ptr<Arena>> &workerArenas) {
+  using namespace wlp4tables;
+  const Token bof = {terminalId("BOF"), "BOF"};
+  const Token eof = {terminalId("EOF"), "EOF"};
+  vector<size_t> bounds = procedureBounds(tokens);
+  size_t numProcs = bounds.size() - 1;
+  size_t numPieces = min<size_t>(jobs, numProcs);
+
+  // procs[i] is procedure i's subtree; the last is main's procedures node
+  vector<SymTree *> procs(numProcs, nullptr);
+  vector<thread> workers;
+  for (size_t k = 0; k < numPieces; ++k) {
+    workerArenas.emplace_back(new Arena);
+    workers.emplace_back([&, k, &pieceArena = *workerArenas.back()] {
+      ParseTrace noTrace{false};
+      for (size_t i = numProcs * k / numPieces; i < numProcs * (k + 1) / numPieces; ++i) {
+        Parser parser{pieceArena, noTrace};
+        parser.push(bof);
+        bool ok = true;
+        for (size_t j = bounds[i]; j < bounds[i + 1] && ok; ++j) ok = parser.push(tokens[j]);
+        bool last = i + 1 == numProcs;
+        ok = ok && parser.reduce(last ? eof.symbol : tokens[bounds[i + 1]].symbol) != 0;
+        if (!ok || parser.symStack.size() != 2) return;
+        SymTree *proc = parser.symStack[1];
+        if (proc->symbol != (last ? "procedures" : "procedure")) return;
+        procs[i] = proc;
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  for (SymTree *proc : procs) {
+    if (proc == nullptr) return nullptr;
+  }
+
+  // procedures -> procedure procedures, from main back to the first
+  int spineRule = productionId("procedures", "procedure procedures");
+  SymTree *spine = procs.back();
+  for (size_t i = numProcs - 1; i-- > 0;) {
+    SymTree *t = arena.make<SymTree>();
+    t->symbol = "procedures";
+    t->children = {arena.makeArray<SymTree *>(2), 2};
+    t->children[0] = procs[i];
+    t->children[1] = spine;
+    t->leaf = false;
+    t->id = spineRule;
+    t->prodRule = PRODUCTIONS[spineRule].RHS;
+    spine = t;
+  }
+  vector<SymTree *> symStack;
+  for (const Token &tok : {bof, eof}) {
+    SymTree *t = arena.make<SymTree>();
+    t->symbol = SYMBOLS[tok.symbol];
+    t->leaf = true;
+    t->id = tok.symbol;
+    t->lexeme = arena.copy(tok.lexeme);
+    symStack.push_back(t);
+  }
+  symStack.insert(symStack.begin() + 1, spine);
+  return mergeIntoOne(symStack, arena);
+}
+
+}
+
+struct WLP4Parser::State {
+  Arena arena; // owns the parse tree
+  vector<unique_ptr<Arena>> workerArenas;
+  ParseTrace trace;
+  Parser parser;
+  SymTree *root = nullptr;
+
+  // When streaming, arena holds only the procedure being parsed; the nodes
+  // left on the stack between procedures live in spine
+  Arena spine;
+  function<void(TreeStream &&)> onProcedure;
+
+  State(bool tracing) : trace{tracing}, parser{arena, trace} {}
+
+  // Moves a node out of arena into spine, without its children
+  SymTree *keep(const SymTree *node) {
+    SymTree *kept = spine.make<SymTree>(*node);
+    kept->children = {};
+    kept->lexeme = spine.copy(node->lexeme);
+    return kept;
+  }
+
+  // Hands on the procedure just reduced and frees everything in arena
+  void release() {
+    trace.flush(); // the events point into arena
+    SymTree *&proc = parser.symStack.back();
+    onProcedure(streamParseTree(proc));
+    proc = keep(proc);
+    arena.clear();
+  }
+};
+
+WLP4Parser::WLP4Parser(bool tracing) : st{new State(tracing)} {
+  // the input is wrapped in BOF and EOF
+  st->parser.push({terminalId("BOF"), "BOF"});
+}
+
+WLP4Parser::~WLP4Parser() {}
+
+bool WLP4Parser::push(const Token &tok) {
+  if (st->parser.push(tok)) return true;
+  // reject if there is no next state in DFA
+  st->trace.flush();
+  return false;
+}
+
+bool WLP4Parser::finish() {
+  bool accepted = st->parser.push({terminalId("EOF"), "EOF"});
+  st->trace.flush();
+  if (accepted) st->root = mergeIntoOne(st->parser.symStack, st->arena);
+  return accepted;
+}
+
+void WLP4Parser::streamProcedures(function<void(TreeStream &&)> onProcedure) {
+  // BOF is already on the stack
+  st->parser.symStack[0] = st->keep(st->parser.symStack[0]);
+  st->onProcedure = move(onProcedure);
+  st->parser.onProcedure = [this] { st->release(); };
+}
+
+void WLP4Parser::flushTrace() {
+  st->trace.flush();
+}
+
+int WLP4Parser::numShifts() const {
+  return st->parser.numShifts;
+}
+
+bool WLP4Parser::parseParallel(const vector<Token> &tokens, unsigned jobs) {
+  st->root = parseProcedures(tokens, jobs, st->arena, st->workerArenas);
+  return st->root != nullptr;
+}
+
+void WLP4Parser::printTree(ostream &out) const {
+  printParseTree(st->root, out);
+}
+
+TreeStream WLP4Parser::tree() const {
+  return streamParseTree(st->root);
+}
@@ -0,0 +1,75 @@
+#ifndef WLP4PARSER_H
+#define WLP4PARSER_H
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <ostream>
+#include "wlp4tree.h"
+
+/*
+ * The WLP4 parser as a library; wlp4parse and wlp4c are drivers around it.
+ *
+ * An LR parser driven by the LALR(1) tables in wlp4tables.h. The tree is
+ * built in an arena owned by the parser, and handed on either as preorder
+ * text or as a TreeStream.
+ */
+
+/* A token to be parsed: its symbol number in the tables, which for a token
+ * from the scanner is its WLP4Token::Kind, and its lexeme.
+ */
+struct Token {
+  int symbol;
+  std::string lexeme;
+};
+
+// Returns the symbol number of a terminal, or NUM_SYMBOLS if kind is not one
+int terminalId(const std::string &kind);
+
+/* Parses one program, token by token, as the tokens arrive. BOF is pushed
+ * when the parser is made and EOF by finish.
+ */
+class WLP4Parser {
+    struct State;
+    std::unique_ptr<State> st;
+
+  public:
+    // If tracing, every shift and reduce is written to stderr
+    explicit WLP4Parser(bool tracing = false);
+    ~WLP4Parser();
+
+    // Shifts tok, after the reductions it calls for. Returns false if tok is
+    // a syntax error.
+    bool push(const Token &tok);
+
+    // Ends the input and completes the tree. Returns false if the program
+    // ends too soon.
+    bool finish();
+
+    // Hands each procedure, and finally main, to onProcedure as a tree of
+    // its own as soon as it is reduced, and then frees it, so that memory
+    // stays proportional to the largest procedure rather than the program.
+    // The whole tree is never built, so printTree and tree may not be used.
+    // Call before the first push.
+    void streamProcedures(std::function<void(TreeStream &&)> onProcedure);
+
+    // Writes out the trace of a parse that is abandoned, as when the
+    // scanner rejects the input; push and finish do so when they fail
+    void flushTrace();
+
+    // The number of tokens shifted so far, BOF included
+    int numShifts() const;
+
+    // Parses the whole program in tokens on up to jobs threads, in place of
+    // push and finish on a new parser. Returns false if any procedure fails
+    // to parse; the program should then be parsed sequentially, so that the
+    // error is reported at the same token.
+    bool parseParallel(const std::vector<Token> &tokens, unsigned jobs);
+
+    // Once the tree is complete: writes it as preorder text lines, or
+    // returns it as a TreeStream whose lexemes are copies
+    void printTree(std::ostream &out) const;
+    TreeStream tree() const;
+};
+
+#endif
@@ -1,194 +1,135 @@
 #include <iostream>
-#include <sstream>
 #include <string>
-#include <map>
-#include <cctype>
 #include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <cstdlib>
+#include "wlp4token.h"
+#include "wlp4scanner.h"
 
 using namespace std;
 
-class State {
-  public:
-    string name;
-    bool accept;
-    // map<input char or word, stateName>
-    map<char, string> stateLookup = {};
-};
-
-// Returns the starting state of the DFA
-State start(map<string, State> &states) { 
-	return states.at("start"); 
-}
-
-void createState(string stateName, map<string, State> &states, bool acc = true) {
-	State newState = State();
-	newState.accept = acc;
-	newState.name = stateName;
-	states[stateName] = newState;
-}
-
-/* Returns the state corresponding to following a transition
-	* from the given starting state on the given character,
-	* or a special fail state if the transition does not exist.
-*/
-State &transition(State &curState, char next, map<string, State> &states) {
-	// first check if its one of the keywords
-	return states.at(curState.stateLookup[next]);
-}
-
-// Register a transition on all chars in chars
-void registerTransition(State &oldState, char chars, string newStateName) {
-	oldState.stateLookup[chars] = newStateName;
-}
+// Binary token stream output, selected with --binary
+bool binaryOutput = false;
+TokenStream binaryTokens;
+unordered_map<string, uint32_t> lexemeIds;
 
-// Register a transition on all chars matching isType
-// For some reason the cctype functions all use ints, hence the function
-// argument type.
-void registerTransition(State &oldState, int (*isType)(int), string newStateName) {
-	for (int c = 0; c < 128; ++c) {
-		if (isType(c)) {
-			oldState.stateLookup[c] = newStateName;
-		}
+void outputTok(WLP4Token::Kind kind, const string &lex, uint32_t offset) {
+	if (binaryOutput) {
+		auto id = lexemeIds.emplace(lex, binaryTokens.lexemes.size());
+		if (id.second) binaryTokens.lexemes.push_back(lex);
+		binaryTokens.tokens.push_back({kind, id.first->second, offset});
+	} else {
+		cout << WLP4Token::kindName(kind) << " " << lex << '\n';
 	}
 }
 
-bool notWS(string stateName) {
-	if (stateName == "COMMENT" ||
-		stateName == "SPACE" ||
-		stateName == "TAB" ||
-		stateName == "NEWLINE") {
-			return false;
-	}
-	return true;
-}
-
-void outputTok(string type, string lex) {
-	if (type == "ID") {
-		if (lex == "int") {
-			type = "INT";
-		} else if (lex == "return") {
-			type = "RETURN";
-		} else if (lex == "if") {
-			type = "IF";
-		} else if (lex == "else") {
-			type = "ELSE";
-		} else if (lex == "while") {
-			type = "WHILE";
-		} else if (lex == "println") {
-			type = "PRINTLN";
-		} else if (lex == "wain") {
-			type = "WAIN";
-		} else if (lex == "new") {
-			type = "NEW";
-		} else if (lex == "delete") {
-			type = "DELETE";
-		} else if (lex == "NULL") {
-			type = "NULL";
-		}
-	}
-	if (type == "NUM") {
-		try {
-			stoi(lex);
-		} catch (const out_of_range& ex) {
-			// Handle the case when the value exceeds INT_MAX
+// Outputs tokens in order, reporting out-of-range numbers
+void emitToks(const vector<ScannedToken> &tokens) {
+	for (auto &tok : tokens) {
+		if (numInRange(tok)) {
+			outputTok(tok.kind, tok.lexeme, tok.offset);
+		} else {
 			cerr << "ERROR" << endl;
-			return;
 		}
 	}
-	if (notWS(type)) {
-		cout << type << " " << lex << endl;
-	}
 }
 
-int main() {
-	map<string, State> states;
-
-	// Define States
-	vector<string> acptStates = {"ID", "NUM", "LPAREN", "RPAREN", "LBRACE", "RBRACE", "BECOMES", "EQ", "NE", "LT", "GT", "LE", "GE", "PLUS", "MINUS", "STAR", "SLASH", "PCT", "COMMA", "SEMI", "LBRACK", "RBRACK", "AMP", "SPACE", "TAB", "NEWLINE", "COMMENT"};
-
-	vector<string> nonAcptStates = {"start", "exclam"};
+/* Parallel scanning of large inputs (-j N).
+ * The input is split just after newlines, and each piece is scanned on its
+ * own thread. A newline always takes the DFA to the NEWLINE state, which
+ * produces no token, so every piece can start from the start state and the
+ * concatenated results match a sequential scan.
+ */
+const size_t MIN_PIECE_SIZE = 1 << 18;
+
+struct PieceResult {
+	vector<ScannedToken> tokens;
+	bool accepted;
+};
 
-	for (vector<string>::iterator it = acptStates.begin(); it != acptStates.end(); ++it) {
-		createState(*it, states);
+bool scanParallel(const string &input, unsigned jobs) {
+	// split the input into pieces that each end just after a newline
+	size_t numPieces = max<size_t>(1, min<size_t>(jobs, input.size() / MIN_PIECE_SIZE));
+	vector<size_t> bounds = {0};
+	for (size_t i = 1; i < numPieces; ++i) {
+		size_t cut = input.find('\n', max(bounds.back(), input.size() / numPieces * i));
+		if (cut == string::npos) break;
+		bounds.push_back(cut + 1);
 	}
-	for (vector<string>::iterator it = nonAcptStates.begin(); it != nonAcptStates.end(); ++it) {
-		createState(*it, states, false);
+	bounds.push_back(input.size());
+
+	vector<PieceResult> results(bounds.size() - 1);
+	vector<thread> workers;
+	for (size_t i = 0; i < results.size(); ++i) {
+		workers.emplace_back([&, i] {
+			PieceResult &res = results[i];
+			TokenScanner scanner(bounds[i]);
+			res.accepted = scanner.feed(input.data() + bounds[i], input.data() + bounds[i + 1], res.tokens);
+			if (i + 1 == results.size()) res.accepted = scanner.finish(res.tokens);
+		});
 	}
+	for (auto &worker : workers) worker.join();
 
-	// Define Transitions
-	registerTransition(states["start"], isalpha, "ID");
-	registerTransition(states["ID"], isalnum, "ID");
-	registerTransition(states["start"], isdigit, "NUM");
-	registerTransition(states["NUM"], isdigit, "NUM");
-	registerTransition(states["start"], '(', "LPAREN");
-	registerTransition(states["start"], ')', "RPAREN");
-	registerTransition(states["start"], '{', "LBRACE");
-	registerTransition(states["start"], '}', "RBRACE");
-	registerTransition(states["start"], '=', "BECOMES");
-	registerTransition(states["BECOMES"], '=', "EQ");
-	registerTransition(states["start"], '!', "exclam");
-	registerTransition(states["exclam"], '=', "NE");
-	registerTransition(states["start"], '<', "LT");
-	registerTransition(states["start"], '>', "GT");
-	registerTransition(states["LT"], '=', "LE");
-	registerTransition(states["GT"], '=', "GE");
-	registerTransition(states["start"], '+', "PLUS");
-	registerTransition(states["start"], '-', "MINUS");
-	registerTransition(states["start"], '*', "STAR");
-	registerTransition(states["start"], '/', "SLASH");
-	registerTransition(states["SLASH"], '/', "COMMENT");
-	registerTransition(states["start"], '%', "PCT");
-	registerTransition(states["start"], ',', "COMMA");
-	registerTransition(states["start"], ';', "SEMI");
-	registerTransition(states["start"], '[', "LBRACK");
-	registerTransition(states["start"], ']', "RBRACK");
-	registerTransition(states["start"], '&', "AMP");
-	registerTransition(states["start"], isspace, "SPACE");
-	registerTransition(states["start"], [](int c) -> int { return c == 9; }, "TAB");
-	registerTransition(states["start"], [](int c) -> int { return c == 10; }, "NEWLINE");
-	registerTransition(states["COMMENT"], [](int c) -> int { return c != '\n'; }, "COMMENT");
-	registerTransition(states["COMMENT"], [](int c) -> int { return c == '\n'; }, "start");
-
-	// Input Section
-	istringstream sock;
-	char c;
-	cin >> noskipws;
-	while (cin >> c) {
-		string charToStr = string(1, c);
-		sock.str(sock.str() + charToStr);
+	// output the pieces in order, stopping at the first rejected piece
+	for (auto &res : results) {
+		emitToks(res.tokens);
+		if (!res.accepted) return false;
 	}
+	return true;
+}
 
-	if (sock.str() == "") return 0;
-
-	State curState = start(states);
-	char curChar;
-	string curToken;
-	int EMPTY = -1;
-	sock >> noskipws;
+int main(int argc, char *argv[]) {
+	ios_base::sync_with_stdio(false);
 
-	while (sock.peek() != EMPTY) {
-		if (curState.stateLookup.find(sock.peek()) == curState.stateLookup.end()) {
-			if (curState.accept == true) {
-				// output token
-				outputTok(curState.name, curToken);
-				// go back to initial state
-				curState = start(states);
-				curToken = "";
-			} else {
-				// reject
-				break;
-			}
+	unsigned jobs = 1;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg == "--binary") {
+			binaryOutput = true;
+		} else if (arg == "-j" && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+			jobs = atoi(argv[++i]);
 		} else {
-			sock >> curChar;
-			curToken.push_back(curChar);
-			curState = transition(curState, curChar, states);
+			cerr << "usage: wlp4scan [--binary] [-j jobs]" << endl;
+			return 1;
 		}
 	}
-	if (curState.accept == true) {
-		// output token and accept
-		outputTok(curState.name, curToken);
+
+	// Input Section
+	// Input is read in fixed-size chunks. A sequential scan runs the DFA
+	// directly over each chunk, so memory use is bounded by the chunk size
+	// plus the token currently being munched. A parallel scan needs the whole
+	// input first.
+	const size_t CHUNK_SIZE = 1 << 16;
+	vector<char> chunk(CHUNK_SIZE);
+	bool accepted;
+
+	if (jobs > 1) {
+		string input;
+		while (cin.read(chunk.data(), chunk.size()) || cin.gcount() > 0) {
+			input.append(chunk.data(), cin.gcount());
+		}
+		accepted = scanParallel(input, jobs);
 	} else {
+		TokenScanner scanner;
+		vector<ScannedToken> tokens;
+		while (!scanner.state().rejected) {
+			cin.read(chunk.data(), chunk.size());
+			streamsize len = cin.gcount();
+			if (len == 0) break;
+			scanner.feed(chunk.data(), chunk.data() + len, tokens);
+			emitToks(tokens);
+			tokens.clear();
+		}
+		accepted = scanner.finish(tokens);
+		emitToks(tokens);
+	}
+
+	if (!accepted) {
 		// reject
 		cerr << "ERROR" << endl;
 	}
-}
\ No newline at end of file
+
+	if (binaryOutput) writeBinaryTokens(cout, binaryTokens);
+}
@@ -0,0 +1,762 @@
+#include <string>
+#include <string_view>
+#include <cctype>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+#include "wlp4scanner.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+/* Fast paths for the runs that make up most of a WLP4 source: whitespace
+ * between tokens, comment bodies, and the tails of identifiers and numbers.
+ * Each returns a pointer to the first byte in [p, end) that ends the run.
+ * Where SSE2 is available the input is tested 16 bytes at a time and the
+ * scalar loop only finishes the last partial block.
+ */
+bool isWhitespace(unsigned char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+bool isCommentBody(unsigned char c) { return c != '\n' && c < 128; }
+bool isDigit(unsigned char c) { return c >= '0' && c <= '9'; }
+bool isAlnum(unsigned char c) { return isDigit(c) || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z'); }
+
+#ifdef __SSE2__
+// Mask of the bytes of v that lie in [lo, hi]
+__m128i inRange(__m128i v, char lo, char hi) {
+	__m128i offset = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+	return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(hi - lo)), offset);
+}
+
+// Advances p a block at a time until stopMask reports a byte ending the run
+template <typename StopMask>
+const char *vectorRunEnd(const char *p, const char *end, StopMask stopMask) {
+	while (end - p >= 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+		unsigned stop = stopMask(block);
+		if (stop != 0) return p + __builtin_ctz(stop);
+		p += 16;
+	}
+	return p;
+}
+#endif
+
+const char *whitespaceEnd(const char *p, const char *end) {
+#ifdef __SSE2__
+	p = vectorRunEnd(p, end, [](__m128i v) {
+		__m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), inRange(v, '\t', '\r'));
+		return ~_mm_movemask_epi8(ws) & 0xffffu;
+	});
+#endif
+	while (p != end && isWhitespace(*p)) ++p;
+	return p;
+}
+
+const char *commentEnd(const char *p, const char *end) {
+#ifdef __SSE2__
+	p = vectorRunEnd(p, end, [](__m128i v) {
+		// newline, or a byte with the high bit set
+		return unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))) | _mm_movemask_epi8(v));
+	});
+#endif
+	while (p != end && isCommentBody(*p)) ++p;
+	return p;
+}
+
+const char *digitsEnd(const char *p, const char *end) {
+#ifdef __SSE2__
+	p = vectorRunEnd(p, end, [](__m128i v) {
+		return ~_mm_movemask_epi8(inRange(v, '0', '9')) & 0xffffu;
+	});
+#endif
+	while (p != end && isDigit(*p)) ++p;
+	return p;
+}
+
+const char *alnumEnd(const char *p, const char *end) {
+#ifdef __SSE2__
+	p = vectorRunEnd(p, end, [](__m128i v) {
+		__m128i letter = inRange(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+		return ~_mm_movemask_epi8(_mm_or_si128(letter, inRange(v, '0', '9'))) & 0xffffu;
+	});
+#endif
+	while (p != end && isAlnum(*p)) ++p;
+	return p;
+}
+
+/* Representation of the WLP4 DFA. States are small integers and the
+ * transition function is a flat [state][byte] table, so following a
+ * transition is a single array load.
+ */
+class WLP4DFA {
+  public:
+	enum State {
+		// Accepting states, in the order of stateNames below
+		ID = 0,
+		NUM,
+		LPAREN,
+		RPAREN,
+		LBRACE,
+		RBRACE,
+		BECOMES,
+		EQ,
+		NE,
+		LT,
+		GT,
+		LE,
+		GE,
+		PLUS,
+		MINUS,
+		STAR,
+		SLASH,
+		PCT,
+		COMMA,
+		SEMI,
+		LBRACK,
+		RBRACK,
+		AMP,
+		SPACE,
+		TAB,
+		NEWLINE,
+		COMMENT,
+
+		// Non-accepting states
+		START,
+		EXCLAM,
+		FAIL,
+
+		// Should always be the final element in the enum, and should always
+		// point to the previous element.
+		LARGEST_STATE = FAIL
+	};
+
+  private:
+	array<array<State, 256>, LARGEST_STATE + 1> transitionFunction;
+
+  public:
+	WLP4DFA() {
+		for (auto &row : transitionFunction) {
+			row.fill(FAIL);
+		}
+
+		// Define Transitions
+		registerTransition(START, isalpha, ID);
+		registerTransition(ID, isalnum, ID);
+		registerTransition(START, isdigit, NUM);
+		registerTransition(NUM, isdigit, NUM);
+		registerTransition(START, '(', LPAREN);
+		registerTransition(START, ')', RPAREN);
+		registerTransition(START, '{', LBRACE);
+		registerTransition(START, '}', RBRACE);
+		registerTransition(START, '=', BECOMES);
+		registerTransition(BECOMES, '=', EQ);
+		registerTransition(START, '!', EXCLAM);
+		registerTransition(EXCLAM, '=', NE);
+		registerTransition(START, '<', LT);
+		registerTransition(START, '>', GT);
+		registerTransition(LT, '=', LE);
+		registerTransition(GT, '=', GE);
+		registerTransition(START, '+', PLUS);
+		registerTransition(START, '-', MINUS);
+		registerTransition(START, '*', STAR);
+		registerTransition(START, '/', SLASH);
+		registerTransition(SLASH, '/', COMMENT);
+		registerTransition(START, '%', PCT);
+		registerTransition(START, ',', COMMA);
+		registerTransition(START, ';', SEMI);
+		registerTransition(START, '[', LBRACK);
+		registerTransition(START, ']', RBRACK);
+		registerTransition(START, '&', AMP);
+		registerTransition(START, isspace, SPACE);
+		registerTransition(START, [](int c) -> int { return c == 9; }, TAB);
+		registerTransition(START, [](int c) -> int { return c == 10; }, NEWLINE);
+		registerTransition(COMMENT, [](int c) -> int { return c != '\n'; }, COMMENT);
+	}
+
+	// Register a transition on a single char
+	void registerTransition(State oldState, char c, State newState) {
+		transitionFunction[oldState][(unsigned char)c] = newState;
+	}
+
+	// Register a transition on all chars matching isType
+	// For some reason the cctype functions all use ints, hence the function
+	// argument type. Only 7-bit characters are ever part of a token.
+	void registerTransition(State oldState, int (*isType)(int), State newState) {
+		for (int c = 0; c < 128; ++c) {
+			if (isType(c)) {
+				transitionFunction[oldState][c] = newState;
+			}
+		}
+	}
+
+	/* Returns the state corresponding to following a transition
+		* from the given starting state on the given byte,
+		* or the FAIL state if the transition does not exist.
+	*/
+	State transition(State state, unsigned char next) const {
+		return transitionFunction[state][next];
+	}
+
+	bool failed(State state) const { return state == FAIL; }
+
+	bool accept(State state) const { return state <= COMMENT; }
+
+	// Returns the starting state of the DFA
+	State start() const { return START; }
+
+	// Checks whether an accepting state produces a token (rather than
+	// whitespace or a comment)
+	bool isToken(State state) const { return state < SPACE; }
+
+	/*
+	 * Converts an accepting state to the kind of token it produces.
+	 * Keywords are scanned as ID and classified afterwards.
+	 */
+	WLP4Token::Kind stateToKind(State state) const {
+		switch (state) {
+			case ID:      return WLP4Token::ID;
+			case NUM:     return WLP4Token::NUM;
+			case LPAREN:  return WLP4Token::LPAREN;
+			case RPAREN:  return WLP4Token::RPAREN;
+			case LBRACE:  return WLP4Token::LBRACE;
+			case RBRACE:  return WLP4Token::RBRACE;
+			case BECOMES: return WLP4Token::BECOMES;
+			case EQ:      return WLP4Token::EQ;
+			case NE:      return WLP4Token::NE;
+			case LT:      return WLP4Token::LT;
+			case GT:      return WLP4Token::GT;
+			case LE:      return WLP4Token::LE;
+			case GE:      return WLP4Token::GE;
+			case PLUS:    return WLP4Token::PLUS;
+			case MINUS:   return WLP4Token::MINUS;
+			case STAR:    return WLP4Token::STAR;
+			case SLASH:   return WLP4Token::SLASH;
+			case PCT:     return WLP4Token::PCT;
+			case COMMA:   return WLP4Token::COMMA;
+			case SEMI:    return WLP4Token::SEMI;
+			case LBRACK:  return WLP4Token::LBRACK;
+			case RBRACK:  return WLP4Token::RBRACK;
+			default:      return WLP4Token::AMP;
+		}
+	}
+};
+
+/* Keyword classification. Each keyword hashes to its own slot of a 16-entry
+ * table by (length - first byte) mod 16, so an ID costs one probe and at most
+ * one comparison. The table is built from KEYWORDS at compile time, and the
+ * build fails if a keyword is added that breaks the hash.
+ */
+struct Keyword {
+	string_view text;
+	WLP4Token::Kind kind;
+};
+
+constexpr Keyword KEYWORDS[] = {
+	{"int", WLP4Token::INT},
+	{"return", WLP4Token::RETURN},
+	{"if", WLP4Token::IF},
+	{"else", WLP4Token::ELSE},
+	{"while", WLP4Token::WHILE},
+	{"println", WLP4Token::PRINTLN},
+	{"wain", WLP4Token::WAIN},
+	{"new", WLP4Token::NEW},
+	{"delete", WLP4Token::DELETE},
+	{"NULL", WLP4Token::NULL_},
+};
+
+constexpr size_t KEYWORD_SLOTS = 16;
+
+constexpr size_t keywordHash(string_view word) {
+	return (word.size() - (unsigned char)word[0]) % KEYWORD_SLOTS;
+}
+
+constexpr array<int, KEYWORD_SLOTS> buildKeywordTable() {
+	array<int, KEYWORD_SLOTS> table{};
+	for (size_t h = 0; h < KEYWORD_SLOTS; ++h) table[h] = -1;
+	for (size_t i = 0; i < size(KEYWORDS); ++i) {
+		size_t h = keywordHash(KEYWORDS[i].text);
+		if (table[h] != -1) throw "keywordHash is no longer perfect";
+		table[h] = i;
+	}
+	return table;
+}
+
+constexpr array<int, KEYWORD_SLOTS> KEYWORD_TABLE = buildKeywordTable();
+
+// Returns the keyword kind of an ID lexeme, or ID if it is not a keyword
+WLP4Token::Kind keywordKind(string_view lex) {
+	int k = KEYWORD_TABLE[keywordHash(lex)];
+	if (k != -1 && KEYWORDS[k].text == lex) return KEYWORDS[k].kind;
+	return WLP4Token::ID;
+}
+
+const WLP4DFA theDFA;
+
+/* Runs simplified maximal munch over the bytes [begin, end), which start at
+ * source offset base, calling emit(kind, lexeme, offset) for each token
+ * munched. Whitespace and comments are not emitted. Stops early, returning
+ * the position reached, if the input is rejected or emit returns false.
+ */
+template <typename Emit>
+const char *munch(MunchState &ms, const char *begin, const char *end, uint32_t base, Emit &&emit) {
+	const WLP4DFA &dfa = theDFA;
+	const char *inputPosn = begin;
+	while (inputPosn != end) {
+		WLP4DFA::State state = WLP4DFA::State(ms.state);
+		// Consume whole runs that cannot leave the current state before
+		// stepping the DFA at the next token boundary. Whitespace and
+		// comment text is never output, so it is skipped outright.
+		switch (state) {
+			case WLP4DFA::START:
+				inputPosn = whitespaceEnd(inputPosn, end);
+				break;
+			case WLP4DFA::COMMENT:
+				inputPosn = commentEnd(inputPosn, end);
+				break;
+			case WLP4DFA::ID:
+			case WLP4DFA::NUM: {
+				const char *runEnd = state == WLP4DFA::ID ? alnumEnd(inputPosn, end)
+				                                          : digitsEnd(inputPosn, end);
+				ms.token.append(inputPosn, runEnd);
+				inputPosn = runEnd;
+				break;
+			}
+			default:
+				break;
+		}
+		if (inputPosn == end) break;
+
+		WLP4DFA::State nextState = dfa.transition(state, *inputPosn);
+		if (dfa.failed(nextState)) {
+			if (dfa.accept(state)) {
+				// go back to initial state, then output token
+				ms.state = dfa.start();
+				if (dfa.isToken(state)) {
+					WLP4Token::Kind kind = dfa.stateToKind(state);
+					if (kind == WLP4Token::ID) kind = keywordKind(ms.token);
+					bool more = emit(kind, ms.token, ms.tokenStart);
+					ms.token.clear();
+					if (!more) break;
+				} else {
+					ms.token.clear();
+				}
+			} else {
+				// reject
+				ms.rejected = true;
+				ms.errorOffset = base + (inputPosn - begin);
+				break;
+			}
+		} else {
+			if (state == dfa.start()) ms.tokenStart = base + (inputPosn - begin);
+			ms.token.push_back(*inputPosn);
+			ms.state = nextState;
+			++inputPosn;
+		}
+	}
+	return inputPosn;
+}
+
+/* Handles the end of the input, which is at source offset base.
+ * Returns false if the input is rejected.
+ */
+template <typename Emit>
+bool finish(MunchState &ms, uint32_t base, Emit &&emit) {
+	const WLP4DFA &dfa = theDFA;
+	WLP4DFA::State state = WLP4DFA::State(ms.state);
+	if (ms.rejected) return false;
+	if (dfa.accept(state)) {
+		if (dfa.isToken(state)) {
+			WLP4Token::Kind kind = dfa.stateToKind(state);
+			if (kind == WLP4Token::ID) kind = keywordKind(ms.token);
+			emit(kind, ms.token, ms.tokenStart);
+		}
+	} else if (state != dfa.start()) {
+		// empty input, or input that ended in skipped whitespace, is accepted
+		ms.rejected = true;
+		ms.errorOffset = base;
+		return false;
+	}
+	ms.state = dfa.start();
+	ms.token.clear();
+	return true;
+}
+
+}
+
+MunchState::MunchState() : state(WLP4DFA::START) {}
+
+bool numInRange(const ScannedToken &tok) {
+	if (tok.kind != WLP4Token::NUM) return true;
+	try {
+		stoi(tok.lexeme);
+	} catch (const out_of_range& ex) {
+		// the value exceeds INT_MAX
+		return false;
+	}
+	return true;
+}
+
+TokenScanner::TokenScanner(uint32_t base) : offset{base} {}
+
+bool TokenScanner::feed(const char *begin, const char *end, vector<ScannedToken> &tokens) {
+	munch(ms, begin, end, offset, [&tokens](WLP4Token::Kind kind, const string &lex, uint32_t tokOffset) {
+		tokens.push_back({kind, lex, tokOffset});
+		return true;
+	});
+	offset += end - begin;
+	return !ms.rejected;
+}
+
+bool TokenScanner::finish(vector<ScannedToken> &tokens) {
+	return ::finish(ms, offset, [&tokens](WLP4Token::Kind kind, const string &lex, uint32_t tokOffset) {
+		tokens.push_back({kind, lex, tokOffset});
+		return true;
+	});
+}
+
+WLP4Scanner::WLP4Scanner(const char *begin, const char *end) : begin{begin}, posn{begin}, end{end} {}
+
+WLP4Scanner::WLP4Scanner(const string &input) : WLP4Scanner(input.data(), input.data() + input.size()) {}
+
+bool WLP4Scanner::next(ScannedToken &tok) {
+	bool found = false;
+	auto take = [&tok, &found](WLP4Token::Kind kind, const string &lex, uint32_t tokOffset) {
+		tok = {kind, lex, tokOffset};
+		found = true;
+		return false; // stop after one token
+	};
+	if (atEnd || ms.rejected) return false;
+	posn = munch(ms, posn, end, posn - begin, take);
+	if (found) return true;
+	if (posn == end) {
+		atEnd = true;
+		::finish(ms, end - begin, take);
+	}
+	return found;
+}
+
+namespace {
+
+/* Fenwick trees, over the pieces of a ScannedSource. sums[i - 1] holds the
+ * total of the values in the range of pieces ending at piece i - 1 whose
+ * length is the lowest set bit of i. Sums are kept modulo 2^32, so a value
+ * is decreased by adding its negation.
+ */
+void fenwickAdd(vector<uint32_t> &sums, size_t i, uint32_t v) {
+	for (++i; i <= sums.size(); i += i & -i) sums[i - 1] += v;
+}
+
+// The total of the first n values
+uint32_t fenwickSum(const vector<uint32_t> &sums, size_t n) {
+	uint32_t total = 0;
+	for (; n > 0; n -= n & -n) total += sums[n - 1];
+	return total;
+}
+
+// The largest n such that the total of the first n values is at most target
+size_t fenwickFind(const vector<uint32_t> &sums, uint32_t target) {
+	size_t n = 0;
+	size_t step = 1;
+	while (step * 2 <= sums.size()) step *= 2;
+	for (; step > 0; step /= 2) {
+		if (n + step <= sums.size() && sums[n + step - 1] <= target) {
+			n += step;
+			target -= sums[n - 1];
+		}
+	}
+	return n;
+}
+
+// Pieces are split once they are longer than twice this, and merged with
+// the next once shorter than half of it
+constexpr uint32_t PIECE_SIZE = 1024;
+
+}
+
+ScannedSource::ScannedSource(const string &text) : pieces(1) {
+	rebuildSums();
+	replacePieces(0, 0, text, {});
+
+	// Munch straight into the pieces that the tokens start in
+	size_t k = 0;
+	uint32_t start = 0;
+	auto add = [&](WLP4Token::Kind kind, const string &lex, uint32_t tokOffset) {
+		while (tokOffset >= start + pieces[k].text.size()) start += pieces[k++].text.size();
+		pieces[k].tokens.push_back({kind, lex, tokOffset - start});
+		return true;
+	};
+	MunchState ms;
+	uint32_t base = 0;
+	for (const Piece &piece : pieces) {
+		if (ms.rejected) break;
+		munch(ms, piece.text.data(), piece.text.data() + piece.text.size(), base, add);
+		base += piece.text.size();
+	}
+	finish(ms, base, add);
+	wasRejected = ms.rejected;
+	rejectOffset = ms.errorOffset;
+	rebuildSums();
+}
+
+// The piece that holds the byte at offset, or the last piece if offset is
+// the end of the text
+size_t ScannedSource::pieceAt(uint32_t offset) const {
+	return min(fenwickFind(lengthSums, offset), pieces.size() - 1);
+}
+
+uint32_t ScannedSource::bytesBefore(size_t piece) const {
+	return fenwickSum(lengthSums, piece);
+}
+
+uint32_t ScannedSource::tokensBefore(size_t piece) const {
+	return fenwickSum(countSums, piece);
+}
+
+void ScannedSource::rebuildSums() {
+	lengthSums.assign(pieces.size(), 0);
+	countSums.assign(pieces.size(), 0);
+	for (size_t i = 1; i <= pieces.size(); ++i) {
+		lengthSums[i - 1] += pieces[i - 1].text.size();
+		countSums[i - 1] += pieces[i - 1].tokens.size();
+		size_t parent = i + (i & -i);
+		if (parent <= pieces.size()) {
+			lengthSums[parent - 1] += lengthSums[i - 1];
+			countSums[parent - 1] += countSums[i - 1];
+		}
+	}
+}
+
+/* Replaces pieces [first, last] with text and the tokens that start in it,
+ * whose offsets are from the start of text, cut into pieces of PIECE_SIZE
+ * bytes or so. If the number of pieces stays the same only their sums are
+ * updated; otherwise the later pieces are renumbered.
+ */
+void ScannedSource::replacePieces(size_t first, size_t last, string text, vector<ScannedToken> tokens) {
+	size_t count = text.size() > 2 * PIECE_SIZE ? text.size() / PIECE_SIZE : 1;
+	if (text.empty() && pieces.size() > last - first + 1) count = 0; // drop it
+	vector<Piece> cut(count);
+	if (count == 1) {
+		cut[0] = {move(text), move(tokens)};
+	} else if (count > 1) {
+		auto next = tokens.begin();
+		uint32_t start = 0;
+		for (size_t k = 0; k < count; ++k) {
+			uint32_t end = text.size() * (k + 1) / count;
+			cut[k].text.assign(text, start, end - start);
+			auto last = partition_point(next, tokens.end(), [end](const ScannedToken &tok) { return tok.offset < end; });
+			cut[k].tokens.assign(make_move_iterator(next), make_move_iterator(last));
+			for (ScannedToken &tok : cut[k].tokens) tok.offset -= start;
+			next = last;
+			start = end;
+		}
+	}
+
+	if (count == last - first + 1) {
+		for (size_t k = first; k <= last; ++k) {
+			// the old contents may have been moved out, so their sizes
+			// are taken from the sums
+			Piece &piece = cut[k - first];
+			fenwickAdd(lengthSums, k, piece.text.size() - (bytesBefore(k + 1) - bytesBefore(k)));
+			fenwickAdd(countSums, k, piece.tokens.size() - (tokensBefore(k + 1) - tokensBefore(k)));
+			pieces[k] = move(piece);
+		}
+	} else {
+		pieces.erase(pieces.begin() + first, pieces.begin() + last + 1);
+		pieces.insert(pieces.begin() + first, make_move_iterator(cut.begin()), make_move_iterator(cut.end()));
+		rebuildSums();
+	}
+}
+
+/* Rewrites the pieces that hold the old text [from, to): the edit is made
+ * to their text, the old tokens [firstToken, lastToken) are replaced by
+ * fresh, whose offsets are in the new text, and the tokens after them move
+ * by the change in length.
+ */
+void ScannedSource::splice(uint32_t from, uint32_t to, size_t firstToken, size_t lastToken,
+                           vector<ScannedToken> fresh, uint32_t offset, uint32_t removedLen,
+                           const string &inserted) {
+	int64_t delta = int64_t(inserted.size()) - removedLen;
+	size_t first = pieceAt(from);
+	size_t last = to > from ? pieceAt(to - 1) : first;
+	uint32_t base = bytesBefore(first);
+	// a piece that would be left short takes in the next one
+	if (bytesBefore(last + 1) - base + delta < PIECE_SIZE / 2 && last + 1 < pieces.size()) ++last;
+
+	string text;
+	vector<ScannedToken> tokens;
+	size_t i = tokensBefore(first);
+	uint32_t pieceBase = 0; // of piece k, from base
+	for (size_t k = first; k <= last; ++k) {
+		for (ScannedToken &tok : pieces[k].tokens) {
+			if (i == firstToken) {
+				for (ScannedToken &tok : fresh) tok.offset -= base;
+				tokens.insert(tokens.end(), make_move_iterator(fresh.begin()), make_move_iterator(fresh.end()));
+			}
+			if (i < firstToken) {
+				tokens.push_back(move(tok));
+				tokens.back().offset += pieceBase;
+			} else if (i >= lastToken) {
+				tokens.push_back(move(tok));
+				tokens.back().offset += pieceBase + delta;
+			}
+			++i;
+		}
+		if (text.empty()) {
+			text = move(pieces[k].text);
+		} else {
+			text += pieces[k].text;
+		}
+		pieceBase = text.size();
+	}
+	if (i <= firstToken) {
+		for (ScannedToken &tok : fresh) tok.offset -= base;
+		tokens.insert(tokens.end(), make_move_iterator(fresh.begin()), make_move_iterator(fresh.end()));
+	}
+	text.replace(offset - base, removedLen, inserted);
+	replacePieces(first, last, move(text), move(tokens));
+}
+
+TokenRange ScannedSource::rescan(uint32_t offset, uint32_t removedLen, const string &inserted) {
+	uint32_t editEnd = offset + removedLen; // in the old text
+	int64_t delta = int64_t(inserted.size()) - removedLen;
+	uint32_t oldSize = size();
+	size_t count = numTokens();
+
+	// A rejection before the edit still stands, and nothing after it was
+	// ever scanned.
+	if (wasRejected && rejectOffset < offset) {
+		splice(offset, editEnd, count, count, {}, offset, removedLen, inserted);
+		return {count, 0, 0};
+	}
+
+	// A token is unaffected if it ends, together with the byte of lookahead
+	// that ended it, before the edit. Restart just after the last such token,
+	// where the DFA was back in its start state. Only the last token that
+	// starts before the piece holding the edit can reach into it.
+	size_t piece = pieceAt(offset);
+	uint32_t pieceStart = bytesBefore(piece);
+	const vector<ScannedToken> &inPiece = pieces[piece].tokens;
+	size_t first = tokensBefore(piece) + (partition_point(inPiece.begin(), inPiece.end(), [&](const ScannedToken &tok) {
+		return pieceStart + tok.offset + tok.lexeme.size() < offset;
+	}) - inPiece.begin());
+	if (first > 0 && first == tokensBefore(piece)) {
+		ScannedToken before = token(first - 1);
+		if (before.offset + before.lexeme.size() >= offset) --first;
+	}
+	uint32_t restart = 0;
+	if (first > 0) {
+		ScannedToken before = token(first - 1);
+		restart = before.offset + before.lexeme.size();
+	}
+
+	// Old tokens from first on, by piece k and index t within it
+	size_t resync = first;
+	size_t k = piece, t = 0;
+	uint32_t kStart = pieceStart;
+	if (first < count) {
+		k = fenwickFind(countSums, first);
+		t = first - tokensBefore(k);
+		kStart = bytesBefore(k);
+	}
+	auto oldOffset = [&] { return int64_t(kStart) + pieces[k].tokens[t].offset; };
+	auto nextOld = [&] {
+		++resync;
+		if (++t < pieces[k].tokens.size()) return;
+		t = 0;
+		do {
+			kStart += pieces[k].text.size();
+			++k;
+		} while (k < pieces.size() && pieces[k].tokens.empty());
+	};
+
+	// Munch new tokens until one starts where an old token starting after
+	// the edit now starts
+	vector<ScannedToken> fresh;
+	bool synced = false;
+	MunchState ms;
+	auto emit = [&](WLP4Token::Kind kind, const string &lex, uint32_t tokOffset) {
+		while (resync < count && (oldOffset() < editEnd || oldOffset() + delta < tokOffset)) nextOld();
+		if (resync < count && oldOffset() + delta == tokOffset) {
+			synced = true;
+			return false;
+		}
+		fresh.push_back({kind, lex, tokOffset});
+		return true;
+	};
+	// Munches the old text [from, to), which starts at from + shift in the
+	// new text
+	auto munchOld = [&](uint32_t from, uint32_t to, int64_t shift) {
+		if (from >= to) return;
+		size_t j = pieceAt(from);
+		uint32_t start = bytesBefore(j);
+		for (; from < to && !synced && !ms.rejected; ++j) {
+			const string &text = pieces[j].text;
+			uint32_t end = min<uint64_t>(text.size(), to - start);
+			munch(ms, text.data() + (from - start), text.data() + end, from + shift, emit);
+			from = start + end;
+			start += text.size();
+		}
+	};
+	munchOld(restart, offset, 0);
+	if (!synced && !ms.rejected) {
+		munch(ms, inserted.data(), inserted.data() + inserted.size(), offset, emit);
+	}
+	munchOld(editEnd, oldSize, delta);
+
+	uint32_t to = oldSize; // the end of the old text that was munched again
+	if (synced) {
+		to = oldOffset();
+		if (wasRejected) rejectOffset += delta;
+	} else {
+		resync = count;
+		if (!ms.rejected) finish(ms, oldSize + delta, [&fresh](WLP4Token::Kind kind, const string &lex, uint32_t tokOffset) {
+			fresh.push_back({kind, lex, tokOffset});
+			return true;
+		});
+		wasRejected = ms.rejected;
+		rejectOffset = ms.errorOffset;
+	}
+
+	TokenRange changed = {first, resync - first, fresh.size()};
+	splice(restart, to, first, resync, move(fresh), offset, removedLen, inserted);
+	return changed;
+}
+
+uint32_t ScannedSource::size() const {
+	return fenwickSum(lengthSums, pieces.size());
+}
+
+string ScannedSource::text() const {
+	string text;
+	text.reserve(size());
+	for (const Piece &piece : pieces) text += piece.text;
+	return text;
+}
+
+size_t ScannedSource::numTokens() const {
+	return fenwickSum(countSums, pieces.size());
+}
+
+ScannedToken ScannedSource::token(size_t i) const {
+	size_t k = fenwickFind(countSums, i);
+	ScannedToken tok = pieces[k].tokens[i - tokensBefore(k)];
+	tok.offset += bytesBefore(k);
+	return tok;
+}
+
+vector<ScannedToken> ScannedSource::tokens() const {
+	vector<ScannedToken> all;
+	uint32_t start = 0;
+	for (const Piece &piece : pieces) {
+		for (const ScannedToken &tok : piece.tokens) {
+			all.push_back(tok);
+			all.back().offset += start;
+		}
+		start += piece.text.size();
+	}
+	return all;
+}
@@ -0,0 +1,157 @@
+#ifndef WLP4SCANNER_H
+#define WLP4SCANNER_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "wlp4token.h"
+
+/*
+ * The WLP4 scanner as a library; wlp4scan is a driver around it.
+ *
+ * Tokens are munched with simplified maximal munch from a DFA whose
+ * transitions live in a flat [state][byte] table. Whitespace and comments
+ * are consumed without producing tokens, and an ID that spells a keyword is
+ * returned with the keyword's kind.
+ */
+
+/* A token munched from the source: its kind, exactly what the programmer
+ * typed, and the byte offset in the source at which it starts.
+ */
+struct ScannedToken {
+  WLP4Token::Kind kind;
+  std::string lexeme;
+  uint32_t offset;
+};
+
+// Checks whether a NUM token fits in a 32-bit int. Out-of-range NUMs are
+// still returned by the scanner; wlp4scan reports them as errors.
+bool numInRange(const ScannedToken &tok);
+
+/* The DFA's progress through the input, carried from one piece of input to
+ * the next. After a token is emitted the DFA is back in its start state, so
+ * only a token that is still being munched is kept here.
+ */
+struct MunchState {
+  int state;                // a state of the scanner's DFA
+  std::string token;        // the bytes munched so far
+  uint32_t tokenStart = 0;  // source offset of token
+  bool rejected = false;
+  uint32_t errorOffset = 0; // where the input was rejected
+
+  MunchState();
+};
+
+/* Scans input that arrives in pieces, such as fixed-size reads from a
+ * stream. A token may span pieces.
+ */
+class TokenScanner {
+    MunchState ms;
+    uint32_t offset; // source offset of the next byte to be fed
+
+  public:
+    // base is the source offset of the first byte that will be fed
+    TokenScanner(uint32_t base = 0);
+
+    // Scans the next piece of input, appending the tokens it completes.
+    // Returns false once the input has been rejected.
+    bool feed(const char *begin, const char *end, std::vector<ScannedToken> &tokens);
+
+    // Ends the input, appending the last token if there is one.
+    // Returns false if the input is rejected.
+    bool finish(std::vector<ScannedToken> &tokens);
+
+    const MunchState &state() const { return ms; }
+};
+
+/* Scans a buffer on demand, one token per call to next, so a parser can
+ * consume tokens as they are munched. The buffer must outlive the scanner.
+ */
+class WLP4Scanner {
+    MunchState ms;
+    const char *begin;
+    const char *posn;
+    const char *end;
+    bool atEnd = false;
+
+  public:
+    WLP4Scanner(const char *begin, const char *end);
+    WLP4Scanner(const std::string &input);
+
+    // Munches the next token into tok. Returns false at the end of the
+    // input, or if the input is rejected.
+    bool next(ScannedToken &tok);
+
+    bool rejected() const { return ms.rejected; }
+    uint32_t errorOffset() const { return ms.errorOffset; }
+};
+
+/* The part of the token list changed by rescan: the old tokens
+ * [first, first + removed) were replaced by the new tokens
+ * [first, first + inserted). Later tokens are unchanged apart from their
+ * offsets, which moved by the change in length of the text.
+ */
+struct TokenRange {
+  size_t first;
+  size_t removed;
+  size_t inserted;
+};
+
+/* A source buffer together with its tokens, as kept by an editor between
+ * edits. If the scanner rejected the text, tokens stop at errorOffset.
+ *
+ * The text is held in pieces of about a kilobyte, each with the tokens that
+ * start in it at offsets from the start of the piece. The pieces' lengths
+ * and token counts are summed in Fenwick trees, so the piece holding a byte
+ * or a token is found in O(log n) steps, and changing one piece's length
+ * moves every later token without touching it.
+ */
+class ScannedSource {
+    struct Piece {
+      std::string text;
+      std::vector<ScannedToken> tokens; // offsets are from the start of text
+    };
+    std::vector<Piece> pieces; // never empty
+    std::vector<uint32_t> lengthSums; // Fenwick trees over the pieces' text
+    std::vector<uint32_t> countSums;  // lengths and token counts
+    bool wasRejected = false;
+    uint32_t rejectOffset = 0;
+
+    size_t pieceAt(uint32_t offset) const;
+    uint32_t bytesBefore(size_t piece) const;
+    uint32_t tokensBefore(size_t piece) const;
+    void rebuildSums();
+    void replacePieces(size_t first, size_t last, std::string text, std::vector<ScannedToken> tokens);
+    void splice(uint32_t from, uint32_t to, size_t firstToken, size_t lastToken,
+                std::vector<ScannedToken> fresh, uint32_t offset, uint32_t removedLen,
+                const std::string &inserted);
+
+  public:
+    // Scans text from scratch
+    explicit ScannedSource(const std::string &text = "");
+
+    /* Replaces removedLen bytes of the text at offset with inserted, and
+     * brings the tokens up to date without rescanning the whole text.
+     *
+     * Scanning restarts just after the last token that the edit cannot have
+     * changed, and stops as soon as a new token starts at the same place in
+     * the unchanged text after the edit as an old one did: the DFA is in its
+     * start state at both, so every later token is the same as before. Only
+     * the pieces from the restart to that token are rewritten, so an edit
+     * costs time proportional to the text scanned plus a piece, and O(log n)
+     * to find its place; a piece that outgrows two kilobytes is split, which
+     * renumbers the pieces after it.
+     */
+    TokenRange rescan(uint32_t offset, uint32_t removedLen, const std::string &inserted);
+
+    uint32_t size() const; // the length of the text
+    std::string text() const;
+    size_t numTokens() const;
+    // Token i, with its offset in the whole text
+    ScannedToken token(size_t i) const;
+    std::vector<ScannedToken> tokens() const;
+
+    bool rejected() const { return wasRejected; }
+    uint32_t errorOffset() const { return rejectOffset; }
+};
+
+#endif
@@ -0,0 +1,396 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <vector>
+#include <bitset>
+#include <algorithm>
+#include "wlp4grammar.h"
+#include "wlp4token.h"
+
+using namespace std;
+
+/*
+ * Build step for wlp4parse: computes LALR(1) parse tables for the grammar in
+ * wlp4grammar.h and writes them to stdout as a header of constexpr integer
+ * tables, so that wlp4parse does no table construction at startup. The same
+ * header names the productions and the positions of their children for
+ * wlp4type and wlp4gen.
+ *
+ *   g++ -std=c++17 wlp4tablegen.cc -o wlp4tablegen
+ *   ./wlp4tablegen > wlp4tables.h
+ *
+ * Symbols are numbered with the terminals first, in WLP4Token::Kind order so
+ * that a token's kind is its symbol number, then any other terminals (BOF and
+ * EOF), then the nonterminals in order of first appearance in the grammar.
+ */
+
+const string EMPTY = ".EMPTY";
+const int MAX_TERMINALS = 128;
+
+typedef bitset<MAX_TERMINALS> Lookahead;
+
+struct Production {
+  int LHS;
+  vector<int> RHS;
+  string text; // the right-hand side as written in the grammar
+};
+
+// An LR(0) item: a production and the position of the dot in it
+typedef pair<int, int> Item;
+
+vector<string> symbols;
+map<string, int> symbolIds;
+int numTerminals;
+vector<Production> prodRules;
+vector<vector<int>> prodsFor; // nonterminal -> its productions
+vector<bool> nullable;        // by symbol
+vector<Lookahead> first;      // by symbol
+
+[[noreturn]] void fail(const string &msg) {
+  cerr << "ERROR: " << msg << endl;
+  exit(1);
+}
+
+void addSymbol(const string &sym) {
+  if (symbolIds.emplace(sym, symbols.size()).second) symbols.push_back(sym);
+}
+
+void loadGrammar() {
+  istringstream in{WLP4_CFG};
+  string s;
+  vector<pair<string, string>> rules;
+  getline(in, s); // CFG section (skip header)
+  while (getline(in, s)) {
+    istringstream rule{s};
+    string lhs, rhs;
+    if (!(rule >> lhs)) continue;
+    getline(rule >> ws, rhs);
+    rules.push_back({lhs, rhs});
+  }
+  if (rules.empty()) fail("no productions");
+
+  // number the symbols
+  for (int k = 0; k <= WLP4Token::LARGEST_KIND; ++k) {
+    addSymbol(WLP4Token::kindName(WLP4Token::Kind(k)));
+  }
+  map<string, bool> isNonterminal;
+  for (auto &rule : rules) isNonterminal[rule.first] = true;
+  for (auto &rule : rules) {
+    istringstream rhs{rule.second};
+    while (rhs >> s) {
+      if (s != EMPTY && !isNonterminal[s]) addSymbol(s);
+    }
+  }
+  numTerminals = symbols.size();
+  if (numTerminals > MAX_TERMINALS) fail("too many terminals");
+  for (auto &rule : rules) addSymbol(rule.first);
+
+  prodsFor.resize(symbols.size());
+  for (auto &rule : rules) {
+    Production prod;
+    prod.LHS = symbolIds[rule.first];
+    prod.text = rule.second;
+    istringstream rhs{rule.second};
+    while (rhs >> s) {
+      if (s != EMPTY) prod.RHS.push_back(symbolIds[s]);
+    }
+    prodsFor[prod.LHS].push_back(prodRules.size());
+    prodRules.push_back(prod);
+  }
+}
+
+// Computes nullable and FIRST for every symbol
+void computeFirst() {
+  nullable.assign(symbols.size(), false);
+  first.assign(symbols.size(), Lookahead());
+  for (int t = 0; t < numTerminals; ++t) first[t].set(t);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto &prod : prodRules) {
+      Lookahead f = first[prod.LHS];
+      bool allNullable = true;
+      for (int sym : prod.RHS) {
+        f |= first[sym];
+        if (!nullable[sym]) {
+          allNullable = false;
+          break;
+        }
+      }
+      if (f != first[prod.LHS] || (allNullable && !nullable[prod.LHS])) {
+        first[prod.LHS] = f;
+        if (allNullable) nullable[prod.LHS] = true;
+        changed = true;
+      }
+    }
+  }
+}
+
+// The LR(0) automaton: each state's kernel items, and its transitions
+vector<vector<Item>> kernels;
+vector<map<int, int>> gotos;
+
+int symbolAfterDot(const Item &item) {
+  const vector<int> &rhs = prodRules[item.first].RHS;
+  return item.second < int(rhs.size()) ? rhs[item.second] : -1;
+}
+
+vector<Item> closure0(const vector<Item> &kernel) {
+  vector<Item> items = kernel;
+  vector<bool> added(symbols.size(), false);
+  for (unsigned i = 0; i < items.size(); ++i) {
+    int sym = symbolAfterDot(items[i]);
+    if (sym < numTerminals || added[sym]) continue;
+    added[sym] = true;
+    for (int p : prodsFor[sym]) items.push_back({p, 0});
+  }
+  return items;
+}
+
+void buildLR0() {
+  map<vector<Item>, int> stateIds;
+  kernels.push_back({{0, 0}});
+  stateIds[kernels[0]] = 0;
+  for (unsigned s = 0; s < kernels.size(); ++s) {
+    map<int, vector<Item>> successors;
+    for (auto &item : closure0(kernels[s])) {
+      int sym = symbolAfterDot(item);
+      if (sym != -1) successors[sym].push_back({item.first, item.second + 1});
+    }
+    gotos.emplace_back();
+    for (auto &succ : successors) {
+      sort(succ.second.begin(), succ.second.end());
+      auto id = stateIds.emplace(succ.second, kernels.size());
+      if (id.second) kernels.push_back(succ.second);
+      gotos[s][succ.first] = id.first->second;
+    }
+  }
+}
+
+/* LALR(1) lookaheads. kernelLookaheads[s] holds the lookaheads of the kernel
+ * items of state s. The LR(1) closure of a state's kernel gives every item of
+ * the state with its lookaheads, and each item passes them on to its
+ * successor in the next state; this is repeated until nothing changes.
+ */
+vector<map<Item, Lookahead>> kernelLookaheads;
+
+map<Item, Lookahead> closure1(int s) {
+  map<Item, Lookahead> items = kernelLookaheads[s];
+  vector<Item> work;
+  for (auto &item : items) work.push_back(item.first);
+  while (!work.empty()) {
+    Item item = work.back();
+    work.pop_back();
+    int sym = symbolAfterDot(item);
+    if (sym < numTerminals) continue;
+    // the lookaheads of B -> .gamma are FIRST(beta L) for A -> alpha .B beta, L
+    const vector<int> &rhs = prodRules[item.first].RHS;
+    Lookahead la;
+    bool restNullable = true;
+    for (unsigned i = item.second + 1; i < rhs.size(); ++i) {
+      la |= first[rhs[i]];
+      if (!nullable[rhs[i]]) {
+        restNullable = false;
+        break;
+      }
+    }
+    if (restNullable) la |= items[item];
+    for (int p : prodsFor[sym]) {
+      Lookahead &cur = items[{p, 0}];
+      if ((cur | la) != cur) {
+        cur |= la;
+        work.push_back({p, 0});
+      }
+    }
+  }
+  return items;
+}
+
+void computeLookaheads() {
+  kernelLookaheads.resize(kernels.size());
+  for (unsigned s = 0; s < kernels.size(); ++s) {
+    for (auto &item : kernels[s]) kernelLookaheads[s][item];
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (unsigned s = 0; s < kernels.size(); ++s) {
+      for (auto &entry : closure1(s)) {
+        int sym = symbolAfterDot(entry.first);
+        if (sym == -1) continue;
+        Lookahead &succ = kernelLookaheads[gotos[s][sym]][{entry.first.first, entry.first.second + 1}];
+        if ((succ | entry.second) != succ) {
+          succ |= entry.second;
+          changed = true;
+        }
+      }
+    }
+  }
+}
+
+int main() {
+  loadGrammar();
+  computeFirst();
+  buildLR0();
+  computeLookaheads();
+  int numStates = kernels.size();
+
+  // Build the full action table, with the encoding described in the
+  // header. The start production is never reduced: the parser stops once it
+  // has shifted EOF.
+  vector<vector<int>> actions(numStates, vector<int>(symbols.size(), 0));
+  for (int s = 0; s < numStates; ++s) {
+    for (auto &trans : gotos[s]) actions[s][trans.first] = trans.second + 1;
+    for (auto &entry : closure1(s)) {
+      if (symbolAfterDot(entry.first) != -1 || entry.first.first == 0) continue;
+      for (int a = 0; a < numTerminals; ++a) {
+        if (!entry.second[a]) continue;
+        int &act = actions[s][a];
+        if (act != 0) {
+          fail("conflict in state " + to_string(s) + " on " + symbols[a]);
+        }
+        act = -(entry.first.first + 1);
+      }
+    }
+  }
+
+  /* Compress the table by row displacement: the nonzero entries of row s
+   * are stored at NEXT[BASE[s] + a], with CHECK[BASE[s] + a] = s marking
+   * them as row s's. Rows are placed densest first, each at the lowest base
+   * where its entries fall into unused slots, so the rows interleave.
+   */
+  vector<int> order(numStates), base(numStates, 0), check, next;
+  vector<int> rowSize(numStates, 0);
+  for (int s = 0; s < numStates; ++s) {
+    order[s] = s;
+    for (int act : actions[s]) rowSize[s] += act != 0;
+  }
+  stable_sort(order.begin(), order.end(), [&](int x, int y) { return rowSize[x] > rowSize[y]; });
+  int numEntries = 0;
+  for (int s : order) {
+    numEntries += rowSize[s];
+    int b = 0;
+    while (true) {
+      bool fits = true;
+      for (unsigned a = 0; a < symbols.size() && fits; ++a) {
+        if (actions[s][a] != 0 && b + a < check.size() && check[b + a] != -1) fits = false;
+      }
+      if (fits) break;
+      ++b;
+    }
+    base[s] = b;
+    // every row must be indexable for every symbol
+    if (check.size() < b + symbols.size()) {
+      check.resize(b + symbols.size(), -1);
+      next.resize(b + symbols.size(), 0);
+    }
+    for (unsigned a = 0; a < symbols.size(); ++a) {
+      if (actions[s][a] == 0) continue;
+      check[b + a] = s;
+      next[b + a] = actions[s][a];
+    }
+  }
+
+  // write the header
+  cout << "// Generated by wlp4tablegen from wlp4grammar.h; do not edit.\n"
+       << "#ifndef WLP4TABLES_H\n#define WLP4TABLES_H\n\n"
+       << "namespace wlp4tables {\n\n"
+       << "constexpr int NUM_TERMINALS = " << numTerminals << ";\n"
+       << "constexpr int NUM_SYMBOLS = " << symbols.size() << ";\n"
+       << "constexpr int NUM_STATES = " << numStates << ";\n"
+       << "constexpr int NUM_PRODUCTIONS = " << prodRules.size() << ";\n\n";
+
+  cout << "constexpr const char *SYMBOLS[NUM_SYMBOLS] = {\n";
+  for (auto &sym : symbols) cout << "  \"" << sym << "\",\n";
+  cout << "};\n\n";
+
+  cout << "struct Production {\n  int LHS;\n  int arity; // number of RHS symbols\n  const char *RHS;\n};\n"
+       << "constexpr Production PRODUCTIONS[NUM_PRODUCTIONS] = {\n";
+  for (auto &prod : prodRules) {
+    cout << "  {" << prod.LHS << ", " << prod.RHS.size() << ", \"" << prod.text << "\"},\n";
+  }
+  cout << "};\n\n";
+
+  // name each production by its rule, so passes over the tree can switch on it
+  vector<string> prodNames;
+  cout << "// Production numbers, named LHS_RHS with .EMPTY as EMPTY\n"
+       << "enum ProductionId : int {\n";
+  for (auto &prod : prodRules) {
+    string name = symbols[prod.LHS];
+    if (prod.RHS.empty()) name += "_EMPTY";
+    for (int sym : prod.RHS) name += "_" + symbols[sym];
+    prodNames.push_back(name);
+    cout << "  " << name << ",\n";
+  }
+  cout << "};\n\n";
+
+  // name each child position, so passes index children instead of searching
+  // them; the k'th occurrence of a symbol after the first is named symk, and
+  // NULL and EOF, which are macros, are NULL_ and EOF_ as in WLP4Token
+  auto childNames = [](const Production &prod) {
+    vector<string> names;
+    map<int, int> seen;
+    for (int sym : prod.RHS) {
+      int k = ++seen[sym];
+      string name = symbols[sym];
+      if (name == "NULL" || name == "EOF") name += "_";
+      names.push_back(name + (k == 1 ? "" : to_string(k)));
+    }
+    return names;
+  };
+  cout << "// Child positions. at::P::X is the index of child X of a node made by\n"
+       << "// production P, and at::N::X that of child X of any node made by\n"
+       << "// nonterminal N, where all of N's productions with an X put it in the\n"
+       << "// same place. A repeated symbol is numbered from its second occurrence,\n"
+       << "// as in at::test::expr2.\n"
+       << "namespace at {\n";
+  for (int n = numTerminals; n < int(symbols.size()); ++n) {
+    vector<pair<string, int>> common; // (name, position or -1 if it varies)
+    for (int p : prodsFor[n]) {
+      vector<string> names = childNames(prodRules[p]);
+      for (int i = 0; i < int(names.size()); ++i) {
+        auto c = find_if(common.begin(), common.end(), [&](auto &c) { return c.first == names[i]; });
+        if (c == common.end()) {
+          common.push_back({names[i], i});
+        } else if (c->second != i) {
+          c->second = -1;
+        }
+      }
+    }
+    stable_sort(common.begin(), common.end(), [](auto &a, auto &b) { return a.second < b.second; });
+    string consts;
+    for (auto &c : common) {
+      if (c.second != -1) consts += (consts.empty() ? "" : ", ") + c.first + " = " + to_string(c.second);
+    }
+    if (!consts.empty()) cout << "  namespace " << symbols[n] << " { constexpr int " << consts << "; }\n";
+  }
+  for (unsigned p = 0; p < prodRules.size(); ++p) {
+    vector<string> names = childNames(prodRules[p]);
+    if (names.empty()) continue;
+    cout << "  namespace " << prodNames[p] << " { constexpr int ";
+    for (unsigned i = 0; i < names.size(); ++i) cout << (i ? ", " : "") << names[i] << " = " << i;
+    cout << "; }\n";
+  }
+  cout << "}\n\n";
+
+  auto writeArray = [](const string &type, const string &name, const vector<int> &values) {
+    cout << "constexpr " << type << " " << name << "[" << values.size() << "] = {";
+    for (unsigned i = 0; i < values.size(); ++i) {
+      cout << (i % 16 == 0 ? "\n  " : " ") << values[i] << ",";
+    }
+    cout << "\n};\n";
+  };
+  size_t denseBytes = numStates * symbols.size() * sizeof(short);
+  size_t packedBytes = (base.size() + check.size() + next.size()) * sizeof(short);
+  cout << "// The action in state s on symbol a, if CHECK[BASE[s] + a] == s, is\n"
+       << "// NEXT[BASE[s] + a]: t + 1 to shift or go to state t, or -(p + 1) to\n"
+       << "// reduce by production p. Any other entry is an error.\n"
+       << "// " << numEntries << " actions in " << next.size() << " slots: "
+       << packedBytes << " bytes, against " << denseBytes << " for a dense table.\n";
+  writeArray("short", "BASE", base);
+  writeArray("short", "CHECK", check);
+  writeArray("short", "NEXT", next);
+
+  cout << "\n}\n\n#endif\n";
+}
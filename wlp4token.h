@@ -0,0 +1,155 @@
+#ifndef WLP4TOKEN_H
+#define WLP4TOKEN_H
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+/*
+ * Token kinds shared by wlp4scan and wlp4parse, and the compact binary
+ * token stream that can be used between them instead of "KIND lexeme" text
+ * lines.
+ */
+
+class WLP4Token {
+  public:
+    enum Kind : uint8_t {
+      ID = 0,
+      NUM,
+      LPAREN,
+      RPAREN,
+      LBRACE,
+      RBRACE,
+      RETURN,
+      IF,
+      ELSE,
+      WHILE,
+      PRINTLN,
+      WAIN,
+      BECOMES,
+      INT,
+      EQ,
+      NE,
+      LT,
+      GT,
+      LE,
+      GE,
+      PLUS,
+      MINUS,
+      STAR,
+      SLASH,
+      PCT,
+      COMMA,
+      SEMI,
+      NEW,
+      DELETE,
+      LBRACK,
+      RBRACK,
+      AMP,
+      NULL_, // NULL is a macro
+
+      // Should always be the final element in the enum, and should always
+      // point to the previous element.
+      LARGEST_KIND = NULL_
+    };
+
+    // Returns the name used for kind in the text token format
+    static const std::string &kindName(Kind kind) {
+      static const std::array<std::string, LARGEST_KIND + 1> names = {
+        "ID", "NUM", "LPAREN", "RPAREN", "LBRACE", "RBRACE", "RETURN", "IF",
+        "ELSE", "WHILE", "PRINTLN", "WAIN", "BECOMES", "INT", "EQ", "NE", "LT",
+        "GT", "LE", "GE", "PLUS", "MINUS", "STAR", "SLASH", "PCT", "COMMA",
+        "SEMI", "NEW", "DELETE", "LBRACK", "RBRACK", "AMP", "NULL"};
+      return names[kind];
+    }
+};
+
+/* A scanned program in the form of the binary token stream.
+ * Each distinct lexeme is stored once in lexemes; tokens refer to it by
+ * index and record the byte offset of the token in the source.
+ *
+ * On the wire the stream is the magic string below, the lexeme and token
+ * counts, each lexeme as a length followed by its bytes, and then each token
+ * as a kind byte, a lexeme index and a source offset. All integers are
+ * 32-bit little-endian. The stream is written in a single block.
+ */
+struct TokenStream {
+  struct Entry {
+    WLP4Token::Kind kind;
+    uint32_t lexeme;
+    uint32_t offset;
+  };
+
+  std::vector<std::string> lexemes;
+  std::vector<Entry> tokens;
+
+  static constexpr char MAGIC[8] = {'W', 'L', 'P', '4', 'T', 'O', 'K', '1'};
+};
+
+namespace tokstream {
+  inline void putWord(std::string &out, uint32_t w) {
+    for (int i = 0; i < 4; ++i) out.push_back(char((w >> (8 * i)) & 0xff));
+  }
+
+  inline bool getWord(const std::string &in, size_t &pos, uint32_t &w) {
+    if (in.size() - pos < 4) return false;
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(in.data() + pos);
+    w = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (uint32_t(bytes[3]) << 24);
+    pos += 4;
+    return true;
+  }
+}
+
+inline void writeBinaryTokens(std::ostream &out, const TokenStream &ts) {
+  std::string block(TokenStream::MAGIC, sizeof(TokenStream::MAGIC));
+  tokstream::putWord(block, ts.lexemes.size());
+  tokstream::putWord(block, ts.tokens.size());
+  for (auto &lexeme : ts.lexemes) {
+    tokstream::putWord(block, lexeme.size());
+    block += lexeme;
+  }
+  for (auto &tok : ts.tokens) {
+    block.push_back(char(tok.kind));
+    tokstream::putWord(block, tok.lexeme);
+    tokstream::putWord(block, tok.offset);
+  }
+  out.write(block.data(), block.size());
+}
+
+// Checks whether input holds a binary token stream rather than text
+inline bool isBinaryTokens(const std::string &input) {
+  return input.compare(0, sizeof(TokenStream::MAGIC), TokenStream::MAGIC,
+                       sizeof(TokenStream::MAGIC)) == 0;
+}
+
+// Decodes a binary token stream; returns false if it is malformed
+inline bool readBinaryTokens(const std::string &input, TokenStream &ts) {
+  if (!isBinaryTokens(input)) return false;
+  size_t pos = sizeof(TokenStream::MAGIC);
+  uint32_t numLexemes, numTokens;
+  if (!tokstream::getWord(input, pos, numLexemes) ||
+      !tokstream::getWord(input, pos, numTokens)) return false;
+  if (numLexemes > input.size() || numTokens > input.size()) return false;
+  ts.lexemes.resize(numLexemes);
+  for (auto &lexeme : ts.lexemes) {
+    uint32_t len;
+    if (!tokstream::getWord(input, pos, len) || input.size() - pos < len) return false;
+    lexeme.assign(input, pos, len);
+    pos += len;
+  }
+  ts.tokens.resize(numTokens);
+  for (auto &tok : ts.tokens) {
+    if (pos == input.size()) return false;
+    unsigned char kind = input[pos++];
+    if (kind > WLP4Token::LARGEST_KIND) return false;
+    tok.kind = WLP4Token::Kind(kind);
+    if (!tokstream::getWord(input, pos, tok.lexeme) ||
+        !tokstream::getWord(input, pos, tok.offset)) return false;
+    if (tok.lexeme >= numLexemes) return false;
+  }
+  return pos == input.size();
+}
+
+#endif
@@ -0,0 +1,358 @@
+#ifndef WLP4TREE_H
+#define WLP4TREE_H
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <iterator>
+#include <utility>
+#include "wlp4tables.h"
+#include "wlp4token.h"
+
+/*
+ * The compact binary parse tree that can be passed from wlp4parse to
+ * wlp4type and from wlp4type to wlp4gen instead of preorder text lines,
+ * and what the tree stages share for reading and walking trees in either
+ * form.
+ */
+
+/* A parse tree, possibly typed, as its nodes in preorder. An interior node
+ * records its production by number, in the order the productions appear in
+ * WLP4_CFG, so no rule text needs to be matched against the grammar when it
+ * is read. A leaf records its terminal and refers to its lexeme by index;
+ * each distinct lexeme is stored once.
+ *
+ * On the wire the tree is the magic string below, the lexeme and node
+ * counts, each lexeme as a length followed by its bytes, and then each node
+ * as a tag byte and a type byte followed by a varint: an interior node's tag
+ * is its production number and the varint its child count, and a leaf's tag
+ * is LEAF_TAG plus its terminal and the varint its lexeme index. A varint is
+ * 7 bits per byte, low bits first, with the top bit set on all but the last
+ * byte, so a typical node takes three or four bytes. The counts and lengths
+ * are 32-bit little-endian. The tree is written in a single block.
+ */
+struct TreeStream {
+  // Leaves are terminals, numbered by token kind with BOF and EOF after them
+  enum Terminal : uint8_t {
+    BOF = WLP4Token::LARGEST_KIND + 1,
+    EOF_,
+    LARGEST_TERMINAL = EOF_
+  };
+
+  enum Type : uint8_t { UNTYPED, INT, INT_STAR };
+
+  static constexpr uint32_t LEAF = 0xffffffff; // the production of a leaf
+  static constexpr uint8_t LEAF_TAG = 0x80;     // productions are numbered below it
+
+  struct Entry {
+    uint32_t prod;        // production number, or LEAF
+    Terminal terminal;    // for a leaf
+    Type type;
+    uint32_t numChildren;
+    uint32_t lexeme;      // for a leaf
+  };
+
+  std::vector<std::string> lexemes;
+  std::vector<Entry> nodes;
+
+  static constexpr char MAGIC[8] = {'W', 'L', 'P', '4', 'T', 'R', 'E', '1'};
+
+  // Returns the name of a terminal as it appears in the grammar
+  static std::string_view terminalName(Terminal t) {
+    if (t == BOF) return "BOF";
+    if (t == EOF_) return "EOF";
+    return WLP4Token::kindName(WLP4Token::Kind(t));
+  }
+
+  // The inverse of terminalName; returns false if name is not a terminal
+  static bool terminalFor(std::string_view name, Terminal &t) {
+    for (int k = 0; k <= LARGEST_TERMINAL; ++k) {
+      if (terminalName(Terminal(k)) == name) {
+        t = Terminal(k);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static std::string_view typeName(Type type) {
+    return type == INT ? "int" : type == INT_STAR ? "int*" : "";
+  }
+
+  static Type typeFor(std::string_view name) {
+    return name == "int" ? INT : name == "int*" ? INT_STAR : UNTYPED;
+  }
+};
+
+namespace treestream {
+  inline void putVarint(std::string &out, uint32_t v) {
+    for (; v >= 0x80; v >>= 7) out.push_back(char(v | 0x80));
+    out.push_back(char(v));
+  }
+
+  inline bool getVarint(const std::string &in, size_t &pos, uint32_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 32 && pos < in.size(); shift += 7) {
+      unsigned char byte = in[pos++];
+      v |= uint32_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) return true;
+    }
+    return false;
+  }
+}
+
+inline void writeBinaryTree(std::ostream &out, const TreeStream &ts) {
+  std::string block(TreeStream::MAGIC, sizeof(TreeStream::MAGIC));
+  tokstream::putWord(block, ts.lexemes.size());
+  tokstream::putWord(block, ts.nodes.size());
+  for (auto &lexeme : ts.lexemes) {
+    tokstream::putWord(block, lexeme.size());
+    block += lexeme;
+  }
+  for (auto &node : ts.nodes) {
+    bool leaf = node.prod == TreeStream::LEAF;
+    block.push_back(char(leaf ? TreeStream::LEAF_TAG + node.terminal : node.prod));
+    block.push_back(char(node.type));
+    treestream::putVarint(block, leaf ? node.lexeme : node.numChildren);
+  }
+  out.write(block.data(), block.size());
+}
+
+/* Builds a TreeStream node by node, in preorder, interning lexemes as they
+ * are added.
+ */
+class TreeWriter {
+    TreeStream ts;
+    std::unordered_map<std::string_view, uint32_t> lexemeIds;
+
+  public:
+    void interior(uint32_t prod, uint32_t numChildren, TreeStream::Type type) {
+      ts.nodes.push_back({prod, TreeStream::Terminal(0), type, numChildren, 0});
+    }
+
+    // lexeme must stay valid until the tree is written
+    void leaf(TreeStream::Terminal terminal, std::string_view lexeme, TreeStream::Type type) {
+      auto id = lexemeIds.emplace(lexeme, ts.lexemes.size());
+      if (id.second) ts.lexemes.emplace_back(lexeme);
+      ts.nodes.push_back({TreeStream::LEAF, terminal, type, 0, id.first->second});
+    }
+
+    void write(std::ostream &out) const { writeBinaryTree(out, ts); }
+
+    // Hands over the tree built so far, leaving the writer empty
+    TreeStream take() {
+      lexemeIds.clear();
+      return std::move(ts);
+    }
+};
+
+// Checks whether input holds a binary tree rather than text
+inline bool isBinaryTree(const std::string &input) {
+  return input.compare(0, sizeof(TreeStream::MAGIC), TreeStream::MAGIC,
+                       sizeof(TreeStream::MAGIC)) == 0;
+}
+
+/* Decodes a binary tree; returns false if it is malformed. arity[p] is the
+ * number of right-hand side symbols of production p. The nodes are checked
+ * to form exactly one tree with the right number of children at every
+ * interior node, so a reader can rebuild it without further checks.
+ */
+inline bool readBinaryTree(const std::string &input, const std::vector<uint32_t> &arity,
+                           TreeStream &ts) {
+  if (!isBinaryTree(input) || arity.size() > TreeStream::LEAF_TAG) return false;
+  size_t pos = sizeof(TreeStream::MAGIC);
+  uint32_t numLexemes, numNodes;
+  if (!tokstream::getWord(input, pos, numLexemes) ||
+      !tokstream::getWord(input, pos, numNodes)) return false;
+  if (numLexemes > input.size() || numNodes > input.size() || numNodes == 0) return false;
+  ts.lexemes.resize(numLexemes);
+  for (auto &lexeme : ts.lexemes) {
+    uint32_t len;
+    if (!tokstream::getWord(input, pos, len) || input.size() - pos < len) return false;
+    lexeme.assign(input, pos, len);
+    pos += len;
+  }
+  ts.nodes.resize(numNodes);
+  size_t pending = 1; // nodes still to come for the tree to be complete
+  for (auto &node : ts.nodes) {
+    if (pending == 0) return false;
+    if (input.size() - pos < 2) return false;
+    unsigned char tag = input[pos++], type = input[pos++];
+    if (type > TreeStream::INT_STAR) return false;
+    node.type = TreeStream::Type(type);
+    uint32_t count;
+    if (!treestream::getVarint(input, pos, count)) return false;
+    if (tag >= TreeStream::LEAF_TAG) {
+      if (tag - TreeStream::LEAF_TAG > TreeStream::LARGEST_TERMINAL || count >= numLexemes) return false;
+      node = {TreeStream::LEAF, TreeStream::Terminal(tag - TreeStream::LEAF_TAG), node.type, 0, count};
+    } else {
+      if (tag >= arity.size() || count != arity[tag]) return false;
+      node = {tag, TreeStream::Terminal(0), node.type, count, 0};
+    }
+    pending = pending - 1 + node.numChildren;
+  }
+  return pending == 0 && pos == input.size();
+}
+
+/* A tree held as parallel arrays indexed by node number, the layout that
+ * wlp4type and wlp4gen work on. Nodes are numbered in preorder, so a pass
+ * over a whole subtree is a scan of a range of each array. The children of
+ * node i are kids[firstChild[i]] onwards, numChildren[i] of them.
+ *
+ * A node's tag is its production number, or LEAF_TAG plus its terminal for
+ * a leaf, as on the wire. Each distinct lexeme is stored once, so a lexeme's
+ * index also serves as a dense ID for the identifier it names.
+ */
+struct FlatTree {
+  std::vector<uint8_t> tag;
+  std::vector<uint32_t> firstChild;
+  std::vector<uint8_t> numChildren;
+  std::vector<uint32_t> lexeme; // for leaves
+  std::vector<TreeStream::Type> type;
+  std::vector<uint32_t> kids;
+  std::vector<std::string> lexemes;
+
+  FlatTree() = default;
+
+  // Takes over the nodes of a complete tree, as checked by readBinaryTree
+  explicit FlatTree(TreeStream &&ts) : lexemes{std::move(ts.lexemes)} {
+    size_t n = ts.nodes.size();
+    tag.resize(n);
+    firstChild.resize(n);
+    numChildren.resize(n);
+    lexeme.resize(n);
+    type.resize(n);
+    kids.resize(n == 0 ? 0 : n - 1);
+    // each node is the next child of the nearest node above it that still
+    // has children to come; a node's slots in kids are reserved when it is
+    // reached
+    std::vector<std::pair<uint32_t, uint32_t>> open; // (node, children placed)
+    uint32_t nextSlot = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      const TreeStream::Entry &node = ts.nodes[i];
+      if (!open.empty()) {
+        uint32_t parent = open.back().first;
+        kids[firstChild[parent] + open.back().second++] = i;
+        if (open.back().second == numChildren[parent]) open.pop_back();
+      }
+      bool leaf = node.prod == TreeStream::LEAF;
+      tag[i] = leaf ? TreeStream::LEAF_TAG + node.terminal : node.prod;
+      type[i] = node.type;
+      lexeme[i] = node.lexeme;
+      numChildren[i] = node.numChildren;
+      firstChild[i] = nextSlot;
+      nextSlot += node.numChildren;
+      if (node.numChildren != 0) open.push_back({i, 0});
+    }
+  }
+
+  size_t size() const { return tag.size(); }
+
+  // One past the last node of the subtree rooted at i
+  uint32_t subtreeEnd(uint32_t i) const {
+    while (numChildren[i] != 0) i = kids[firstChild[i] + numChildren[i] - 1];
+    return i + 1;
+  }
+
+  TreeStream toStream() const {
+    TreeStream ts;
+    ts.lexemes = lexemes;
+    ts.nodes.reserve(size());
+    for (uint32_t i = 0; i < size(); ++i) {
+      if (tag[i] >= TreeStream::LEAF_TAG) {
+        ts.nodes.push_back({TreeStream::LEAF, TreeStream::Terminal(tag[i] - TreeStream::LEAF_TAG),
+                            type[i], 0, lexeme[i]});
+      } else {
+        ts.nodes.push_back({tag[i], TreeStream::Terminal(0), type[i], numChildren[i], 0});
+      }
+    }
+    return ts;
+  }
+};
+
+// The symbol of each node tag: the left-hand side of a production, or the
+// name of a terminal
+inline const std::array<std::string_view, 256> TAG_SYMBOLS = [] {
+  using namespace wlp4tables;
+  std::array<std::string_view, 256> names{};
+  for (int p = 0; p < NUM_PRODUCTIONS; ++p) names[p] = SYMBOLS[PRODUCTIONS[p].LHS];
+  for (int t = 0; t <= TreeStream::LARGEST_TERMINAL; ++t) {
+    names[TreeStream::LEAF_TAG + t] = TreeStream::terminalName(TreeStream::Terminal(t));
+  }
+  return names;
+}();
+
+/* A node of the tree that *current points to, by number, as the passes over
+ * a FlatTree see it. Tree is const FlatTree for a pass that only reads the
+ * tree. Symbols and rules point into the generated tables.
+ */
+template <typename Tree, Tree **current>
+struct TreeNode {
+  uint32_t i;
+
+  bool leaf() const { return (*current)->tag[i] >= TreeStream::LEAF_TAG; }
+  // for interior nodes, a ProductionId
+  int prod() const { return leaf() ? -1 : (*current)->tag[i]; }
+  // for leaves, a WLP4Token::Kind or TreeStream::BOF or EOF_
+  int terminal() const { return leaf() ? (*current)->tag[i] - TreeStream::LEAF_TAG : -1; }
+  std::string_view symbol() const { return TAG_SYMBOLS[(*current)->tag[i]]; }
+  std::string_view prodRule() const { return wlp4tables::PRODUCTIONS[prod()].RHS; }
+  std::string_view lexeme() const { return (*current)->lexemes[(*current)->lexeme[i]]; }
+  int symId() const { return (*current)->lexeme[i]; } // for ID leaves
+  auto &type() const { return (*current)->type[i]; }
+  size_t numChildren() const { return (*current)->numChildren[i]; }
+  // k is a position from wlp4tables::at, such as at::dcl::type
+  TreeNode child(size_t k) const { return {(*current)->kids[(*current)->firstChild[i] + k]}; }
+};
+
+// Returns the number of the production lhs -> rhs, or -1 if there is none
+inline int productionId(std::string_view lhs, std::string_view rhs) {
+  using namespace wlp4tables;
+  for (int p = 0; p < NUM_PRODUCTIONS; ++p) {
+    if (SYMBOLS[PRODUCTIONS[p].LHS] == lhs && PRODUCTIONS[p].RHS == rhs) return p;
+  }
+  return -1;
+}
+
+/* Builds a TreeStream from a tree written as preorder text lines, a line at
+ * a time. Each line is a symbol followed by a production's right-hand side
+ * or a leaf's lexeme; the caller splits it, and reads off any type.
+ */
+class TextTreeReader {
+    TreeStream &ts;
+    std::unordered_map<std::string, uint32_t> lexemeIds;
+    size_t pending = 1; // nodes still to come for the tree to be complete
+
+  public:
+    explicit TextTreeReader(TreeStream &ts) : ts{ts} {}
+
+    void node(const std::string &left, const std::string &right, TreeStream::Type type) {
+      int prod = productionId(left, right);
+      if (prod != -1) {
+        uint32_t arity = wlp4tables::PRODUCTIONS[prod].arity;
+        ts.nodes.push_back({uint32_t(prod), TreeStream::Terminal(0), type, arity, 0});
+        pending += arity;
+      } else {
+        TreeStream::Terminal terminal = TreeStream::Terminal(0);
+        TreeStream::terminalFor(left, terminal);
+        auto id = lexemeIds.emplace(right, ts.lexemes.size());
+        if (id.second) ts.lexemes.push_back(right);
+        ts.nodes.push_back({TreeStream::LEAF, terminal, type, 0, id.first->second});
+      }
+      --pending;
+    }
+
+    // Checks whether every node of the tree has been read
+    bool done() const { return pending == 0; }
+};
+
+// Reads the rest of in, such as a whole tree from standard input
+inline std::string loadInput(std::istream &in) {
+  return std::string{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+#endif
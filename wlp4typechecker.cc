@@ -0,0 +1,397 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <string_view>
+#include "wlp4tables.h"
+#include "wlp4tree.h"
+#include "wlp4typechecker.h"
+
+using namespace std;
+using namespace wlp4tables;
+
+namespace {
+
+typedef TreeStream::Type Type;
+const Type UNTYPED = TreeStream::UNTYPED, INT = TreeStream::INT, INT_STAR = TreeStream::INT_STAR;
+
+// The tree being checked. Identifiers are numbered by their interned
+// lexeme, so symbol tables are indexed by that instead of keyed by name.
+FlatTree *tree;
+
+// A node of tree, by number
+typedef TreeNode<FlatTree, &tree> SymTree;
+
+class Signature {
+  vector<Type> argTypes;
+ public:
+  const vector<Type> &getSig() const {
+    return argTypes;
+  }
+  void pushType(Type type) {
+    argTypes.push_back(type);
+  }
+};
+
+class SymbolTable {
+  vector<pair<int, Type>> locals; // (symbol ID, type) in declaration order
+ public:
+  const vector<pair<int, Type>> &getLocals() const {
+    return locals;
+  }
+  void pushType(int id, Type type) {
+    locals.push_back(make_pair(id, type));
+  }
+};
+
+// The variables of the procedure currently being processed, as a flat table
+// indexed by symbol ID. declare enters a procedure's SymbolTable before
+// visiting its body.
+class Scope {
+  SymbolTable *cur = nullptr;
+  vector<Type> varTypes;
+ public:
+  void enter(SymbolTable &table) {
+    if (cur) {
+      for (auto &local : cur->getLocals()) varTypes[local.first] = UNTYPED;
+    }
+    cur = &table;
+    varTypes.resize(tree->lexemes.size());
+    for (auto &local : cur->getLocals()) varTypes[local.first] = local.second;
+  }
+  Type getVarType(int id) {
+    return varTypes[id];
+  }
+  void pushType(int id, Type type) {
+    cur->pushType(id, type);
+    varTypes[id] = type;
+  }
+};
+
+class Err {
+  string message;
+  public:
+    Err(string message) : message{message} {}
+    // Returns the message associated with the exception.
+    const string &msg() const { return message; }
+};
+
+/* The tree is checked in one walk: declare enters each declaration into the
+ * symbol tables on the way down, and checkNode types and checks each node on
+ * the way up, once its subtrees have been, so every node is visited once.
+ * walk uses an explicit stack rather than recursion: statements and dcls are
+ * left-recursive, so the tree is as deep as a procedure is long. preorder
+ * visits a subtree as a scan of its range of node numbers.
+ */
+
+// Calls visit on each node in preorder, stopping if it returns false.
+// Returns false if the walk was stopped.
+template <typename Visit>
+bool preorder(SymTree root, Visit &&visit) {
+  for (uint32_t i = root.i, end = tree->subtreeEnd(root.i); i < end; ++i) {
+    if (!visit(SymTree{i})) return false;
+  }
+  return true;
+}
+
+// Calls pre on each node before its subtrees are walked and post after
+template <typename Pre, typename Post>
+void walk(SymTree root, Pre &&pre, Post &&post) {
+  vector<pair<SymTree, bool>> stack = {{root, false}}; // (node, subtrees pushed)
+  while (!stack.empty()) {
+    SymTree t = stack.back().first;
+    if (stack.back().second) {
+      stack.pop_back();
+      post(t);
+      continue;
+    }
+    stack.back().second = true;
+    pre(t);
+    for (size_t i = t.numChildren(); i-- > 0;) stack.push_back({t.child(i), false});
+  }
+}
+
+struct Procedure {
+  Signature sig;
+  SymbolTable loc;
+};
+// Procedures in declaration order, and the index of each procedure by the
+// symbol ID of its name in the tree being checked (-1 for names that are
+// not procedures). The index by name carries procedures over from one tree
+// to the next when a program is checked a procedure at a time. wain cannot
+// be called, so it is kept separately.
+deque<Procedure> procedures;
+vector<int> procIndex;
+unordered_map<string, int> procByName;
+Procedure wain;
+Scope scope;
+
+Procedure *findProc(int id) {
+  if (procIndex[id] == -1) return nullptr;
+  return &procedures[procIndex[id]];
+}
+
+void pushParams(SymTree root, Signature &sig) {
+  preorder(root, [&sig](SymTree t) {
+    if (t.prod() == dcl_type_ID) {
+      if (t.child(at::dcl::type).prod() == type_INT) {
+        sig.pushType(INT);
+      } else {
+        sig.pushType(INT_STAR);
+      }
+    }
+    return true;
+  });
+}
+
+bool checkArgs(SymTree root, Signature &s) {
+  // root is an arglist node
+  // can have children "expr" or "expr COMMA arglist"
+  const vector<Type> &sig = s.getSig();
+  for (unsigned count = 1; ; ++count) {
+    if (count > sig.size()) return false; // too many args
+    if (root.child(at::arglist::expr).type() != sig.at(count - 1)) return false;
+    if (root.prod() == arglist_expr) return count == sig.size();
+    // arglist child is present
+    root = root.child(at::arglist::arglist);
+  }
+}
+
+// Enters the procedure or variable that root declares into the symbol
+// tables, before its subtrees are checked
+void declare(SymTree root) {
+  Type type;
+  int varId;
+  switch (root.prod()) {
+  case main_INT_WAIN_LPAREN_dcl_COMMA_dcl_RPAREN_LBRACE_dcls_statements_RETURN_expr_SEMI_RBRACE:
+    // add entry in global symbol table for WAIN
+    pushParams(root.child(at::main::dcl), wain.sig);
+    pushParams(root.child(at::main::dcl2), wain.sig);
+    scope.enter(wain.loc);
+    break;
+  case procedure_INT_ID_LPAREN_params_RPAREN_LBRACE_dcls_statements_RETURN_expr_SEMI_RBRACE: {
+    int procId = root.child(at::procedure::ID).symId();
+    if (findProc(procId) != nullptr) {
+      throw Err("ERROR1");
+    }
+    procIndex[procId] = procedures.size();
+    procByName.emplace(root.child(at::procedure::ID).lexeme(), procedures.size());
+    procedures.push_back(Procedure());
+    pushParams(root.child(at::procedure::params), procedures.back().sig);
+    scope.enter(procedures.back().loc);
+    break;
+  }
+  case dcl_type_ID:
+    if (root.child(at::dcl::type).prod() == type_INT) {
+      type = INT;
+    } else {
+      type = INT_STAR;
+    }
+    varId = root.child(at::dcl::ID).symId();
+    if (scope.getVarType(varId) != UNTYPED) {
+      throw Err("ERROR2");
+    }
+    scope.pushType(varId, type);
+    break;
+  }
+}
+
+// Types and checks one node; its subtrees have already been
+void checkNode(SymTree root) {
+  // base cases
+  if (root.terminal() == WLP4Token::NUM) root.type() = INT;
+  if (root.terminal() == WLP4Token::NULL_) root.type() = INT_STAR;
+  switch (root.prod()) {
+  case main_INT_WAIN_LPAREN_dcl_COMMA_dcl_RPAREN_LBRACE_dcls_statements_RETURN_expr_SEMI_RBRACE:
+    if (root.child(at::main::dcl2).child(at::dcl::type).prod() != type_INT) throw Err("ERROR14");
+    if (root.child(at::main::expr).type() != INT) throw Err("ERROR15");
+    break;
+  case procedure_INT_ID_LPAREN_params_RPAREN_LBRACE_dcls_statements_RETURN_expr_SEMI_RBRACE:
+    if (root.child(at::procedure::expr).type() != INT) throw Err("ERROR15");
+    break;
+  case dcls_dcls_dcl_BECOMES_NUM_SEMI:
+    if (root.child(at::dcls::dcl).child(at::dcl::type).prod() != type_INT) throw Err("ERROR16");
+    break;
+  case dcls_dcls_dcl_BECOMES_NULL_SEMI:
+    if (root.child(at::dcls::dcl).child(at::dcl::type).prod() != type_INT_STAR) throw Err("ERROR16");
+    break;
+  case dcl_type_ID:
+    root.child(at::dcl::ID).type() = scope.getVarType(root.child(at::dcl::ID).symId());
+    break;
+
+  // statements
+  case statement_lvalue_BECOMES_expr_SEMI:
+    if (root.child(at::statement_lvalue_BECOMES_expr_SEMI::lvalue).type() !=
+        root.child(at::statement_lvalue_BECOMES_expr_SEMI::expr).type()) throw Err("ERROR17");
+    break;
+  case statement_PRINTLN_LPAREN_expr_RPAREN_SEMI:
+    if (root.child(at::statement_PRINTLN_LPAREN_expr_RPAREN_SEMI::expr).type() != INT) throw Err("ERROR18");
+    break;
+  case statement_DELETE_LBRACK_RBRACK_expr_SEMI:
+    if (root.child(at::statement_DELETE_LBRACK_RBRACK_expr_SEMI::expr).type() != INT_STAR) throw Err("ERROR19");
+    break;
+  case test_expr_EQ_expr:
+  case test_expr_NE_expr:
+  case test_expr_LT_expr:
+  case test_expr_LE_expr:
+  case test_expr_GE_expr:
+  case test_expr_GT_expr:
+    if (root.child(at::test::expr).type() != root.child(at::test::expr2).type()) throw Err("ERROR20");
+    break;
+
+  // expressions
+  case factor_ID:
+  case lvalue_ID: {
+    SymTree id = root.prod() == factor_ID ? root.child(at::factor_ID::ID) : root.child(at::lvalue_ID::ID);
+    id.type() = scope.getVarType(id.symId());
+    if (id.type() == UNTYPED) {
+      throw Err("ERROR3");
+    }
+    root.type() = id.type();
+    break;
+  }
+  case expr_term: root.type() = root.child(at::expr_term::term).type(); break;
+  case term_factor: root.type() = root.child(at::term_factor::factor).type(); break;
+  case factor_NUM: root.type() = root.child(at::factor::NUM).type(); break;
+  case factor_NULL: root.type() = root.child(at::factor::NULL_).type(); break;
+  case factor_LPAREN_expr_RPAREN: root.type() = root.child(at::factor_LPAREN_expr_RPAREN::expr).type(); break;
+  case expr_expr_PLUS_term:
+    if (root.child(at::expr_expr_PLUS_term::expr).type() == INT &&
+        root.child(at::expr_expr_PLUS_term::term).type() == INT) {
+      root.type() = INT;
+    } else if (root.child(at::expr_expr_PLUS_term::expr).type() == INT_STAR &&
+               root.child(at::expr_expr_PLUS_term::term).type() == INT) {
+      root.type() = INT_STAR;
+    } else if (root.child(at::expr_expr_PLUS_term::expr).type() == INT &&
+               root.child(at::expr_expr_PLUS_term::term).type() == INT_STAR) {
+      root.type() = INT_STAR;
+    } else {
+      throw Err("ERROR5");
+    }
+    break;
+  case expr_expr_MINUS_term:
+    if (root.child(at::expr_expr_MINUS_term::expr).type() == INT &&
+        root.child(at::expr_expr_MINUS_term::term).type() == INT) {
+      root.type() = INT;
+    } else if (root.child(at::expr_expr_MINUS_term::expr).type() == INT_STAR &&
+               root.child(at::expr_expr_MINUS_term::term).type() == INT) {
+      root.type() = INT_STAR;
+    } else if (root.child(at::expr_expr_MINUS_term::expr).type() == INT_STAR &&
+               root.child(at::expr_expr_MINUS_term::term).type() == INT_STAR) {
+      root.type() = INT;
+    } else {
+      throw Err("ERROR6");
+    }
+    break;
+  case term_term_STAR_factor:
+    if (root.child(at::term_term_STAR_factor::term).type() != INT ||
+        root.child(at::term_term_STAR_factor::factor).type() != INT) throw Err("ERROR7");
+    root.type() = INT;
+    break;
+  case term_term_SLASH_factor:
+    if (root.child(at::term_term_SLASH_factor::term).type() != INT ||
+        root.child(at::term_term_SLASH_factor::factor).type() != INT) throw Err("ERROR8");
+    root.type() = INT;
+    break;
+  case term_term_PCT_factor:
+    if (root.child(at::term_term_PCT_factor::term).type() != INT ||
+        root.child(at::term_term_PCT_factor::factor).type() != INT) throw Err("ERROR9");
+    root.type() = INT;
+    break;
+  case factor_AMP_lvalue:
+    if (root.child(at::factor::lvalue).type() != INT) throw Err("ERROR10");
+    root.type() = INT_STAR;
+    break;
+  case factor_STAR_factor:
+    if (root.child(at::factor::factor).type() != INT_STAR) throw Err("ERROR11");
+    root.type() = INT;
+    break;
+  case factor_NEW_INT_LBRACK_expr_RBRACK:
+    if (root.child(at::factor_NEW_INT_LBRACK_expr_RBRACK::expr).type() != INT) throw Err("ERROR12");
+    root.type() = INT_STAR;
+    break;
+  case lvalue_STAR_factor:
+    if (root.child(at::lvalue::factor).type() != INT_STAR) throw Err("ERROR13");
+    root.type() = INT;
+    break;
+  case lvalue_LPAREN_lvalue_RPAREN:
+    root.type() = root.child(at::lvalue::lvalue).type();
+    break;
+
+  // procedure calls
+  case factor_ID_LPAREN_RPAREN: {
+    Procedure *func = findProc(root.child(at::factor::ID).symId());
+    if (func == nullptr) throw Err("ERROR4");
+    // if signature requires args, the call is wrong
+    if (func->sig.getSig().size() != 0) throw Err("ERROR21");
+    root.type() = INT;
+    break;
+  }
+  case factor_ID_LPAREN_arglist_RPAREN: {
+    // also check that arglist matches signature
+    Procedure *func = findProc(root.child(at::factor::ID).symId());
+    if (func == nullptr) throw Err("ERROR4");
+    if (!checkArgs(root.child(at::factor::arglist), func->sig)) throw Err("ERROR21");
+    root.type() = INT;
+    break;
+  }
+  }
+}
+
+// Checks the tree t against the procedures declared so far, which it adds
+// to
+bool checkTree(FlatTree &t) {
+  tree = &t;
+  procIndex.assign(t.lexemes.size(), -1);
+  for (uint32_t id = 0; id < t.lexemes.size(); ++id) {
+    auto proc = procByName.find(t.lexemes[id]);
+    if (proc != procByName.end()) procIndex[id] = proc->second;
+  }
+  scope = Scope();
+  SymTree parseTree{0};
+
+  try {
+    walk(parseTree, declare, checkNode);
+  } catch (Err &e) {
+    // cerr << e.msg() << endl;
+    return false;
+  }
+  return true;
+}
+
+}
+
+bool typeCheck(FlatTree &t) {
+  startTypeCheck();
+  return checkTree(t);
+}
+
+void startTypeCheck() {
+  procedures.clear();
+  procByName.clear();
+  wain = Procedure();
+}
+
+bool typeCheckProcedure(FlatTree &t) {
+  size_t first = procedures.size();
+  bool wellTyped = checkTree(t);
+  // later procedures only need the signature
+  for (size_t p = first; p < procedures.size(); ++p) procedures[p].loc = SymbolTable();
+  return wellTyped;
+}
+
+void printTypedTree(const FlatTree &t, ostream &out) {
+  for (uint32_t i = 0; i < t.size(); ++i) {
+    out << TAG_SYMBOLS[t.tag[i]] << " ";
+    if (t.tag[i] >= TreeStream::LEAF_TAG) {
+      out << t.lexemes[t.lexeme[i]];
+    } else {
+      out << PRODUCTIONS[t.tag[i]].RHS;
+    }
+    if (t.type[i] != UNTYPED) {
+      out << " : " << TreeStream::typeName(t.type[i]);
+    }
+    out << '\n';
+  }
+}
@@ -0,0 +1,32 @@
+#ifndef WLP4TYPECHECKER_H
+#define WLP4TYPECHECKER_H
+#include <ostream>
+#include "wlp4tree.h"
+
+/*
+ * The WLP4 type checker as a library; wlp4type and wlp4c are drivers
+ * around it.
+ *
+ * A program is checked in a single walk over its tree, in time linear in its
+ * size: declarations enter the symbol tables as they are reached, and each
+ * expression, statement and declaration is typed and checked once, after
+ * its subtrees.
+ */
+
+// Builds the symbol tables for the program in tree and types its nodes in
+// place. Returns false if the program is not well typed.
+bool typeCheck(FlatTree &tree);
+
+/* Checks a program one procedure at a time, for a compile that streams
+ * procedures from the parser. startTypeCheck begins a program, and then each
+ * procedure and finally main is checked in order, each in a tree of its own
+ * rooted at its procedure or main node, against the signatures of the
+ * procedures before it. Only those signatures are kept between calls.
+ */
+void startTypeCheck();
+bool typeCheckProcedure(FlatTree &tree);
+
+// Writes a tree as preorder text lines, with " : type" after typed nodes
+void printTypedTree(const FlatTree &tree, std::ostream &out);
+
+#endif